@@ -0,0 +1,325 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "rudp-bbr.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RudpBbr");
+
+NS_OBJECT_ENSURE_REGISTERED (RudpBbr);
+
+// 2/ln(2), the smallest gain doubling the delivery rate every round
+static const double STARTUP_GAIN = 2.885; //!< Pacing and window gain of STARTUP
+
+// Pacing gains of the PROBE_BW phases, one round each
+static const double GAIN_CYCLE[] = { 1.25, 0.75, 1, 1, 1, 1, 1, 1 }; //!< PROBE_BW gain cycle
+static const uint32_t GAIN_CYCLE_LENGTH = 8; //!< Phases of the gain cycle
+
+TypeId
+RudpBbr::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpBbr")
+    .SetParent<RudpCongestionOps> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpBbr> ()
+    .AddAttribute ("InitialWindow", "Initial congestion window, in segments",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&RudpBbr::m_initialWindow),
+                   MakeUintegerChecker<uint32_t> (4))
+    .AddAttribute ("BandwidthWindow", "Rounds the bottleneck bandwidth max filter spans",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&RudpBbr::m_bandwidthWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MinRttWindow", "Time the lowest RTT is trusted before PROBE_RTT measures it again",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&RudpBbr::m_minRttWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("ProbeRttDuration", "Time spent with the minimal window in PROBE_RTT",
+                   TimeValue (MilliSeconds (200)),
+                   MakeTimeAccessor (&RudpBbr::m_probeRttDuration),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+RudpBbr::RudpBbr ()
+  : m_segmentSize (0),
+    m_mode (STARTUP),
+    m_cwnd (0),
+    m_priorCwnd (0),
+    m_pacingGain (STARTUP_GAIN),
+    m_cwndGain (STARTUP_GAIN),
+    m_bandwidth (0),
+    m_fullBandwidth (0),
+    m_fullBandwidthRounds (0),
+    m_filledPipe (false),
+    m_minRttExpired (false),
+    m_delivered (0),
+    m_roundDelivered (0),
+    m_round (0),
+    m_cycleIndex (0),
+    m_lossInCycle (false)
+{
+  NS_LOG_FUNCTION (this);
+  m_uv = CreateObject<UniformRandomVariable> ();
+}
+
+RudpBbr::~RudpBbr ()
+{
+}
+
+std::string
+RudpBbr::GetName (void) const
+{
+  return "RudpBbr";
+}
+
+void
+RudpBbr::SetSegmentSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  if (m_cwnd == 0)
+    {
+      m_cwnd = m_initialWindow * size;
+      m_bandwidthSamples.assign (m_bandwidthWindow, 0);
+    }
+  m_segmentSize = size;
+}
+
+void
+RudpBbr::PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << ackedBytes << bytesInFlight);
+  Time now = Simulator::Now ();
+  m_delivered += ackedBytes;
+  if (!m_minRtt.IsZero () && now - m_roundStart >= m_minRtt)
+    {
+      if (!m_roundStart.IsZero ())
+        {
+          UpdateBandwidth ((m_delivered - m_roundDelivered) / (now - m_roundStart).GetSeconds ());
+        }
+      m_roundStart = now;
+      m_roundDelivered = m_delivered;
+    }
+  UpdateMode (bytesInFlight);
+  UpdateCongestionWindow (ackedBytes);
+}
+
+void
+RudpBbr::UpdateBandwidth (double sample)
+{
+  m_round++;
+  m_bandwidthSamples[m_round % m_bandwidthWindow] = sample;
+  m_bandwidth = *std::max_element (m_bandwidthSamples.begin (), m_bandwidthSamples.end ());
+  NS_LOG_LOGIC ("Round " << m_round << ", delivery rate " << sample << ", bandwidth " << m_bandwidth);
+
+  if (m_filledPipe)
+    {
+      return;
+    }
+  // The pipe is full once three rounds in a row could not grow the
+  // bandwidth by 25%
+  if (m_bandwidth >= m_fullBandwidth * 1.25)
+    {
+      m_fullBandwidth = m_bandwidth;
+      m_fullBandwidthRounds = 0;
+    }
+  else if (++m_fullBandwidthRounds >= 3)
+    {
+      m_filledPipe = true;
+    }
+}
+
+void
+RudpBbr::UpdateMode (uint32_t bytesInFlight)
+{
+  Time now = Simulator::Now ();
+  if (m_mode == STARTUP && m_filledPipe)
+    {
+      NS_LOG_LOGIC ("Pipe filled, entering DRAIN");
+      m_mode = DRAIN;
+      m_pacingGain = 1 / STARTUP_GAIN;
+      m_cwndGain = STARTUP_GAIN;
+    }
+  if (m_mode == DRAIN && bytesInFlight <= GetBdp ())
+    {
+      EnterProbeBandwidth ();
+    }
+  if (m_mode == PROBE_BW)
+    {
+      // A phase lasts a round. Probing up also waits until the extra data
+      // is in flight or is lost, draining stops as soon as the queue is gone
+      bool fullLength = now - m_cycleStart > m_minRtt;
+      bool advance = fullLength;
+      if (m_pacingGain > 1)
+        {
+          advance = fullLength && (m_lossInCycle || bytesInFlight >= m_pacingGain * GetBdp ());
+        }
+      else if (m_pacingGain < 1)
+        {
+          advance = fullLength || bytesInFlight <= GetBdp ();
+        }
+      if (advance)
+        {
+          m_cycleIndex = (m_cycleIndex + 1) % GAIN_CYCLE_LENGTH;
+          m_cycleStart = now;
+          m_pacingGain = GAIN_CYCLE[m_cycleIndex];
+          m_lossInCycle = false;
+        }
+    }
+
+  if (m_mode != PROBE_RTT && m_minRttExpired)
+    {
+      NS_LOG_LOGIC ("Lowest RTT expired, entering PROBE_RTT");
+      m_mode = PROBE_RTT;
+      m_pacingGain = 1;
+      m_priorCwnd = m_cwnd;
+      m_probeRttDone = Time (0);
+    }
+  if (m_mode == PROBE_RTT)
+    {
+      if (m_probeRttDone.IsZero () && bytesInFlight <= GetMinWindow ())
+        {
+          m_probeRttDone = now + m_probeRttDuration;
+        }
+      else if (!m_probeRttDone.IsZero () && now >= m_probeRttDone)
+        {
+          m_minRttStamp = now;
+          m_minRttExpired = false;
+          m_cwnd = std::max (m_cwnd, m_priorCwnd);
+          if (m_filledPipe)
+            {
+              EnterProbeBandwidth ();
+            }
+          else
+            {
+              m_mode = STARTUP;
+              m_pacingGain = STARTUP_GAIN;
+              m_cwndGain = STARTUP_GAIN;
+            }
+        }
+    }
+}
+
+void
+RudpBbr::EnterProbeBandwidth (void)
+{
+  NS_LOG_LOGIC ("Entering PROBE_BW");
+  m_mode = PROBE_BW;
+  m_cwndGain = 2;
+  // Any phase but the draining one, so that flows do not probe in step
+  m_cycleIndex = m_uv->GetInteger (0, GAIN_CYCLE_LENGTH - 2);
+  if (m_cycleIndex >= 1)
+    {
+      m_cycleIndex++;
+    }
+  m_cycleStart = Simulator::Now ();
+  m_pacingGain = GAIN_CYCLE[m_cycleIndex];
+  m_lossInCycle = false;
+}
+
+void
+RudpBbr::UpdateCongestionWindow (uint32_t ackedBytes)
+{
+  if (m_mode == PROBE_RTT)
+    {
+      m_cwnd = std::min (m_cwnd, GetMinWindow ());
+      return;
+    }
+  uint32_t bdp = GetBdp ();
+  if (bdp == 0)
+    {
+      // No model yet, grow as slow start does
+      m_cwnd += ackedBytes;
+      return;
+    }
+  // Three more segments absorb delayed and stretched acknowledgements
+  uint32_t target = static_cast<uint32_t> (m_cwndGain * bdp) + 3 * m_segmentSize;
+  if (m_filledPipe)
+    {
+      m_cwnd = std::min (m_cwnd + ackedBytes, target);
+    }
+  else if (m_cwnd < target || m_delivered < m_initialWindow * m_segmentSize)
+    {
+      m_cwnd += ackedBytes;
+    }
+  m_cwnd = std::max (m_cwnd, GetMinWindow ());
+}
+
+void
+RudpBbr::CongestionEvent (uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << bytesInFlight);
+  // Random losses say nothing about the bottleneck, the model does not
+  // change. They only end a probe for more bandwidth
+  m_lossInCycle = true;
+}
+
+void
+RudpBbr::RttSample (Time rtt)
+{
+  Time now = Simulator::Now ();
+  bool expired = !m_minRtt.IsZero () && now > m_minRttStamp + m_minRttWindow;
+  if (m_minRtt.IsZero () || rtt <= m_minRtt || expired)
+    {
+      m_minRtt = rtt;
+      m_minRttStamp = now;
+    }
+  // Only PROBE_RTT refreshes an expired sample
+  m_minRttExpired = expired;
+}
+
+void
+RudpBbr::Timeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  // Everything in flight may be lost, restart from the smallest window
+  // and let the acknowledgements grow it back to the model
+  m_cwnd = GetMinWindow ();
+}
+
+uint32_t
+RudpBbr::GetCongestionWindow (void) const
+{
+  return m_cwnd;
+}
+
+DataRate
+RudpBbr::GetPacingRate (void) const
+{
+  return DataRate (static_cast<uint64_t> (m_pacingGain * m_bandwidth * 8));
+}
+
+uint32_t
+RudpBbr::GetBdp (void) const
+{
+  return static_cast<uint32_t> (m_bandwidth * m_minRtt.GetSeconds ());
+}
+
+uint32_t
+RudpBbr::GetMinWindow (void) const
+{
+  return 4 * m_segmentSize;
+}
+
+} // namespace ns3
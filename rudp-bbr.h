@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#ifndef RUDP_BBR_H
+#define RUDP_BBR_H
+
+#include <vector>
+#include "ns3/random-variable-stream.h"
+#include "rudp-congestion-ops.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup rudp
+ * \brief BBR-style model-based congestion control
+ *
+ * Instead of reacting to losses, the controller keeps a model of the
+ * path: the bottleneck bandwidth, the highest delivery rate of the last
+ * rounds, and the propagation delay, the lowest RTT of the last seconds.
+ * It paces at the bandwidth times a gain and keeps about two
+ * bandwidth-delay products in flight:
+ *
+ * - STARTUP doubles the rate every round until the bandwidth stops
+ *   growing,
+ * - DRAIN empties the queue built by STARTUP,
+ * - PROBE_BW cycles the pacing gain, 1.25 for a round to look for more
+ *   bandwidth, 0.75 to drain what that queued, then 1 for six rounds,
+ * - PROBE_RTT shrinks the window to four segments for a while, when the
+ *   lowest RTT has not been seen again for too long, to measure it
+ *   without the flow's own queue.
+ *
+ * The socket reports acknowledgements without per packet delivery
+ * state, so rounds last one propagation delay and give one delivery rate
+ * sample each. Losses do not change the model: they only end a probe for
+ * more bandwidth, and timeouts restart from a small window.
+ */
+class RudpBbr : public RudpCongestionOps
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  RudpBbr ();
+  virtual ~RudpBbr ();
+
+  /**
+   * \brief BBR modes
+   */
+  typedef enum
+  {
+    STARTUP,   //!< Exponential search for the bandwidth
+    DRAIN,     //!< Drain the queue built by STARTUP
+    PROBE_BW,  //!< Steady state, cycling the pacing gain
+    PROBE_RTT, //!< Minimal window to measure the propagation delay
+  } BbrMode_t;
+
+  virtual std::string GetName (void) const;
+  virtual void SetSegmentSize (uint32_t size);
+  virtual void PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight);
+  virtual void CongestionEvent (uint32_t bytesInFlight);
+  virtual void RttSample (Time rtt);
+  virtual void Timeout (void);
+  virtual uint32_t GetCongestionWindow (void) const;
+  virtual DataRate GetPacingRate (void) const;
+
+private:
+  /**
+   * \brief End a round with a delivery rate sample
+   * \param sample the delivery rate of the round (bytes/s)
+   */
+  void UpdateBandwidth (double sample);
+  /**
+   * \brief Switch mode when the model says so
+   * \param bytesInFlight the bytes sent and not acknowledged
+   */
+  void UpdateMode (uint32_t bytesInFlight);
+  /**
+   * \brief Grow the window towards its target
+   * \param ackedBytes the bytes newly acknowledged
+   */
+  void UpdateCongestionWindow (uint32_t ackedBytes);
+  /**
+   * \brief Enter PROBE_BW, in a random phase of the gain cycle
+   */
+  void EnterProbeBandwidth (void);
+  /**
+   * \brief Get the bandwidth-delay product
+   * \return the BDP in bytes, 0 until the model has its first samples
+   */
+  uint32_t GetBdp (void) const;
+  /**
+   * \brief Get the smallest window
+   * \return four segments
+   */
+  uint32_t GetMinWindow (void) const;
+
+  uint32_t m_segmentSize;           //!< Largest payload of a data packet
+  uint32_t m_initialWindow;         //!< Initial window, in segments
+  uint32_t m_bandwidthWindow;       //!< Rounds the bandwidth max filter spans
+  Time m_minRttWindow;              //!< Time a propagation delay sample is trusted
+  Time m_probeRttDuration;          //!< Time spent with the minimal window in PROBE_RTT
+  BbrMode_t m_mode;                 //!< Current mode
+  uint32_t m_cwnd;                  //!< Congestion window
+  uint32_t m_priorCwnd;             //!< Window before PROBE_RTT
+  double m_pacingGain;              //!< Current pacing gain
+  double m_cwndGain;                //!< Current window gain
+  std::vector<double> m_bandwidthSamples; //!< Delivery rate of the last rounds (bytes/s)
+  double m_bandwidth;               //!< Bottleneck bandwidth, max of the samples (bytes/s)
+  double m_fullBandwidth;           //!< Bandwidth when it last grew by 25%
+  uint32_t m_fullBandwidthRounds;   //!< Rounds without 25% growth
+  bool m_filledPipe;                //!< STARTUP found the bandwidth
+  Time m_minRtt;                    //!< Propagation delay, lowest recent RTT
+  Time m_minRttStamp;               //!< When m_minRtt was measured
+  bool m_minRttExpired;             //!< m_minRtt is older than m_minRttWindow
+  Time m_probeRttDone;              //!< End of PROBE_RTT, zero until the window is small
+  uint64_t m_delivered;             //!< Bytes acknowledged since the start
+  uint64_t m_roundDelivered;        //!< m_delivered at the start of the round
+  Time m_roundStart;                //!< Start of the round
+  uint32_t m_round;                 //!< Round count
+  uint32_t m_cycleIndex;            //!< Phase of the gain cycle
+  Time m_cycleStart;                //!< Start of the phase
+  bool m_lossInCycle;               //!< A congestion event happened in the phase
+  Ptr<UniformRandomVariable> m_uv;  //!< Picks the first phase of the gain cycle
+};
+
+} // namespace ns3
+
+#endif /* RUDP_BBR_H */
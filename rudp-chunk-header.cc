@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#include "rudp-chunk-header.h"
+#include "rudp-header.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (RudpChunkHeader);
+
+RudpChunkHeader::RudpChunkHeader ()
+  : m_messageNumber (0),
+    m_length (0),
+    m_inorderFlag (false)
+{
+}
+
+RudpChunkHeader::~RudpChunkHeader ()
+{
+}
+
+void
+RudpChunkHeader::SetLength (uint16_t length)
+{
+  m_length = length;
+}
+
+uint16_t
+RudpChunkHeader::GetLength (void) const
+{
+  return m_length;
+}
+
+void
+RudpChunkHeader::SetMessageNumber (uint32_t messageNumber)
+{
+  m_messageNumber = (messageNumber & RudpHeader::MAX_MESSAGE_NUMBER);
+}
+
+uint32_t
+RudpChunkHeader::GetMessageNumber (void) const
+{
+  return m_messageNumber;
+}
+
+void
+RudpChunkHeader::SetInorderFlag (bool inorderFlag)
+{
+  m_inorderFlag = inorderFlag;
+}
+
+bool
+RudpChunkHeader::GetInorderFlag (void) const
+{
+  return m_inorderFlag;
+}
+
+TypeId
+RudpChunkHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpChunkHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpChunkHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+RudpChunkHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+RudpChunkHeader::Print (std::ostream &os) const
+{
+  os << "length: " << m_length << " M.No.: " << m_messageNumber
+     << " inorder flag: " << m_inorderFlag;
+}
+
+uint32_t
+RudpChunkHeader::GetSerializedSize (void) const
+{
+  return SIZE;
+}
+
+void
+RudpChunkHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteHtonU16 (m_length);
+  i.WriteHtonU32 (((uint32_t) m_inorderFlag << 31) | m_messageNumber);
+}
+
+uint32_t
+RudpChunkHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_length = i.ReadNtohU16 ();
+  uint32_t word = i.ReadNtohU32 ();
+  m_inorderFlag = (word >> 31);
+  m_messageNumber = (word & RudpHeader::MAX_MESSAGE_NUMBER);
+  return SIZE;
+}
+
+} // namespace ns3
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#ifndef RUDP_CHUNK_HEADER_H
+#define RUDP_CHUNK_HEADER_H
+
+#include <stdint.h>
+#include "ns3/header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup rudp
+ * \brief Sub-header of a message bundled with others in one data packet
+ *
+ * A data packet with the bundle flag set carries a sequence of chunks,
+ * each made of this header followed by the message itself: the length of
+ * the message, then the in-order flag and the message number in one
+ * 32-bit word. The chunks share the sequence number of the packet, so
+ * they are acknowledged and retransmitted together.
+ */
+class RudpChunkHeader : public Header
+{
+public:
+  RudpChunkHeader ();
+  virtual ~RudpChunkHeader ();
+
+  /**
+   * \brief Size of a chunk header
+   */
+  static const uint32_t SIZE = 6;
+
+  /**
+   * \param length the size of the message following the header
+   */
+  void SetLength (uint16_t length);
+  /**
+   * \return the size of the message following the header
+   */
+  uint16_t GetLength (void) const;
+  /**
+   * \param messageNumber the message number
+   */
+  void SetMessageNumber (uint32_t messageNumber);
+  /**
+   * \return the message number
+   */
+  uint32_t GetMessageNumber (void) const;
+  /**
+   * \param inorderFlag true if the message must be delivered in order
+   */
+  void SetInorderFlag (bool inorderFlag);
+  /**
+   * \return true if the message must be delivered in order
+   */
+  bool GetInorderFlag (void) const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint32_t m_messageNumber; //!< Message number
+  uint16_t m_length;        //!< Size of the message
+  bool m_inorderFlag;       //!< Message must be delivered in order
+};
+
+} // namespace ns3
+
+#endif /* RUDP_CHUNK_HEADER_H */
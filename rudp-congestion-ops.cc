@@ -0,0 +1,251 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "rudp-congestion-ops.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RudpCongestionOps");
+
+NS_OBJECT_ENSURE_REGISTERED (RudpCongestionOps);
+
+TypeId
+RudpCongestionOps::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpCongestionOps")
+    .SetParent<Object> ()
+    .SetGroupName ("Internet")
+  ;
+  return tid;
+}
+
+RudpCongestionOps::RudpCongestionOps ()
+{
+}
+
+RudpCongestionOps::~RudpCongestionOps ()
+{
+}
+
+void
+RudpCongestionOps::PacketSent (uint32_t size, uint32_t bytesInFlight)
+{
+}
+
+void
+RudpCongestionOps::RttSample (Time rtt)
+{
+}
+
+void
+RudpCongestionOps::ForwardDelaySample (Time delay)
+{
+}
+
+DataRate
+RudpCongestionOps::GetPacingRate (void) const
+{
+  return DataRate (0);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (RudpDaimd);
+
+TypeId
+RudpDaimd::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpDaimd")
+    .SetParent<RudpCongestionOps> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpDaimd> ()
+    .AddAttribute ("InitialWindow", "Initial congestion window, in segments",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&RudpDaimd::m_initialWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ControlInterval", "Interval between two rate increases",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&RudpDaimd::m_controlInterval),
+                   MakeTimeChecker (MicroSeconds (1)))
+  ;
+  return tid;
+}
+
+RudpDaimd::RudpDaimd ()
+  : m_segmentSize (0),
+    m_cwnd (0),
+    m_slowStart (true),
+    m_lossInInterval (false),
+    m_sendPeriod (1.0),
+    m_lastDecreasePeriod (1.0),
+    m_deliveryRate (0),
+    m_bandwidth (0),
+    m_ackedInInterval (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+RudpDaimd::~RudpDaimd ()
+{
+}
+
+std::string
+RudpDaimd::GetName (void) const
+{
+  return "RudpDaimd";
+}
+
+void
+RudpDaimd::SetSegmentSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  if (m_cwnd == 0)
+    {
+      m_cwnd = m_initialWindow * size;
+    }
+  m_segmentSize = size;
+}
+
+void
+RudpDaimd::PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << ackedBytes << bytesInFlight);
+  if (m_slowStart && bytesInFlight + ackedBytes >= m_cwnd / 2)
+    {
+      // Only grow while the window is what limits the flow
+      m_cwnd += ackedBytes;
+    }
+
+  Time now = Simulator::Now ();
+  if (m_intervalStart.IsZero ())
+    {
+      m_intervalStart = now;
+    }
+  m_ackedInInterval += ackedBytes;
+  if (now - m_intervalStart < m_controlInterval)
+    {
+      return;
+    }
+
+  // End of a control interval
+  double sample = m_ackedInInterval / (now - m_intervalStart).GetSeconds ();
+  m_deliveryRate = (m_deliveryRate == 0) ? sample : 0.875 * m_deliveryRate + 0.125 * sample;
+  m_bandwidth = (sample > m_bandwidth) ? sample : 0.875 * m_bandwidth + 0.125 * sample;
+  m_ackedInInterval = 0;
+  m_intervalStart = now;
+  bool loss = m_lossInInterval;
+  m_lossInInterval = false;
+  if (m_slowStart)
+    {
+      return;
+    }
+
+  m_cwnd = static_cast<uint32_t> (m_deliveryRate * (m_rtt + m_controlInterval).GetSeconds ())
+    + m_initialWindow * m_segmentSize;
+  if (loss)
+    {
+      return;
+    }
+
+  // UDT's increase, in packets per control interval: the further the rate
+  // is from the bandwidth, the larger the step
+  double interval = m_controlInterval.GetMicroSeconds ();
+  double bandwidth = m_bandwidth / m_segmentSize;
+  double spare = bandwidth - 1000000.0 / m_sendPeriod;
+  if (m_sendPeriod > m_lastDecreasePeriod && bandwidth / 9 < spare)
+    {
+      spare = bandwidth / 9;
+    }
+  double increase = 1.0 / m_segmentSize;
+  if (spare > 0)
+    {
+      increase = std::max (increase, std::pow (10.0, std::ceil (std::log10 (spare * m_segmentSize * 8.0)))
+                           * 0.0000015 / m_segmentSize);
+    }
+  m_sendPeriod = (m_sendPeriod * interval) / (m_sendPeriod * increase + interval);
+  NS_LOG_LOGIC ("Send period " << m_sendPeriod << " us, window " << m_cwnd);
+}
+
+void
+RudpDaimd::CongestionEvent (uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << bytesInFlight);
+  m_lossInInterval = true;
+  if (m_slowStart)
+    {
+      ExitSlowStart ();
+      return;
+    }
+  m_lastDecreasePeriod = m_sendPeriod;
+  m_sendPeriod *= 1.125;
+  NS_LOG_LOGIC ("Send period " << m_sendPeriod << " us");
+}
+
+void
+RudpDaimd::RttSample (Time rtt)
+{
+  m_rtt = m_rtt.IsZero () ? rtt : (m_rtt * 7 + rtt) / 8;
+}
+
+void
+RudpDaimd::Timeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  // As UDT, a timeout only ends slow start, the losses it reveals are
+  // reported as congestion events
+  if (m_slowStart)
+    {
+      ExitSlowStart ();
+    }
+}
+
+uint32_t
+RudpDaimd::GetCongestionWindow (void) const
+{
+  return m_cwnd;
+}
+
+DataRate
+RudpDaimd::GetPacingRate (void) const
+{
+  if (m_slowStart)
+    {
+      return DataRate (0);
+    }
+  return DataRate (static_cast<uint64_t> (m_segmentSize * 8.0 * 1000000.0 / m_sendPeriod));
+}
+
+void
+RudpDaimd::ExitSlowStart (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_slowStart = false;
+  if (m_deliveryRate > 0)
+    {
+      m_sendPeriod = m_segmentSize * 1000000.0 / m_deliveryRate;
+    }
+  else if (!m_rtt.IsZero ())
+    {
+      m_sendPeriod = (m_rtt + m_controlInterval).GetMicroSeconds () * static_cast<double> (m_segmentSize) / m_cwnd;
+    }
+}
+
+} // namespace ns3
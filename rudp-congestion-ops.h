@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#ifndef RUDP_CONGESTION_OPS_H
+#define RUDP_CONGESTION_OPS_H
+
+#include <stdint.h>
+#include <string>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup rudp
+ * \brief Interface of the RUDP congestion controllers
+ *
+ * The socket reports what happens to its data packets through the hooks
+ * below, and asks the controller for the congestion window, and for the
+ * rate new data is paced at. A RUDP socket creates its controller from
+ * the TypeId in its CongestionControl attribute.
+ *
+ * Sizes are in bytes. A loss is reported once per congestion event: the
+ * losses of packets sent before the previous report are not.
+ */
+class RudpCongestionOps : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  RudpCongestionOps ();
+  virtual ~RudpCongestionOps ();
+
+  /**
+   * \brief Get the name of the congestion control algorithm
+   * \return a string identifying the algorithm
+   */
+  virtual std::string GetName (void) const = 0;
+  /**
+   * \brief Set the size of a full data packet
+   *
+   * Called before any other hook, and again when the path MTU lowers it.
+   *
+   * \param size the largest payload of a data packet
+   */
+  virtual void SetSegmentSize (uint32_t size) = 0;
+  /**
+   * \brief A data packet was sent or retransmitted
+   * \param size the size of the packet
+   * \param bytesInFlight the bytes sent and not yet acknowledged
+   */
+  virtual void PacketSent (uint32_t size, uint32_t bytesInFlight);
+  /**
+   * \brief A SACK acknowledged data
+   * \param ackedBytes the bytes newly acknowledged
+   * \param bytesInFlight the bytes still sent and not acknowledged
+   */
+  virtual void PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight) = 0;
+  /**
+   * \brief Packets were lost, starting a congestion event
+   * \param bytesInFlight the bytes sent and not acknowledged
+   */
+  virtual void CongestionEvent (uint32_t bytesInFlight) = 0;
+  /**
+   * \brief The socket measured a RTT
+   * \param rtt the RTT sample
+   */
+  virtual void RttSample (Time rtt);
+  /**
+   * \brief The socket measured the one-way delay of a data packet
+   *
+   * The delay includes the offset between the clocks of the two hosts, only
+   * its variations are meaningful.
+   *
+   * \param delay the delay sample
+   */
+  virtual void ForwardDelaySample (Time delay);
+  /**
+   * \brief The retransmission timer expired
+   */
+  virtual void Timeout (void) = 0;
+  /**
+   * \brief Get the congestion window
+   * \return the bytes that may be in flight
+   */
+  virtual uint32_t GetCongestionWindow (void) const = 0;
+  /**
+   * \brief Get the rate new data is paced at
+   * \return the rate, 0 to pace at the window over the RTT
+   */
+  virtual DataRate GetPacingRate (void) const;
+};
+
+/**
+ * \ingroup rudp
+ * \brief UDT's DAIMD, decreasing additive increase multiplicative decrease
+ *
+ * The flow starts in slow start, its window growing by the bytes
+ * acknowledged. After the first loss the sending rate is controlled
+ * instead: every rate control interval without loss it increases by an
+ * amount that shrinks as the rate gets closer to the estimated
+ * bandwidth, and each congestion event decreases it by 1/9. The window
+ * then only bounds the data in flight to what the delivery rate needs
+ * over one RTT.
+ *
+ * UDT estimates the bandwidth with packet pairs probed by the receiver,
+ * this uses the highest delivery rate seen by the sender instead.
+ */
+class RudpDaimd : public RudpCongestionOps
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  RudpDaimd ();
+  virtual ~RudpDaimd ();
+
+  virtual std::string GetName (void) const;
+  virtual void SetSegmentSize (uint32_t size);
+  virtual void PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight);
+  virtual void CongestionEvent (uint32_t bytesInFlight);
+  virtual void RttSample (Time rtt);
+  virtual void Timeout (void);
+  virtual uint32_t GetCongestionWindow (void) const;
+  virtual DataRate GetPacingRate (void) const;
+
+private:
+  /**
+   * \brief Leave slow start, sending at the delivery rate
+   */
+  void ExitSlowStart (void);
+
+  uint32_t m_segmentSize;    //!< Largest payload of a data packet
+  uint32_t m_initialWindow;  //!< Initial window, in segments
+  Time m_controlInterval;    //!< Rate control interval (UDT's SYN)
+  uint32_t m_cwnd;           //!< Congestion window
+  bool m_slowStart;          //!< In slow start
+  bool m_lossInInterval;     //!< A congestion event happened in this control interval
+  double m_sendPeriod;       //!< Time between two data packets (microseconds)
+  double m_lastDecreasePeriod; //!< m_sendPeriod before the last decrease
+  Time m_rtt;                //!< Smoothed RTT
+  double m_deliveryRate;     //!< Smoothed delivery rate (bytes/s)
+  double m_bandwidth;        //!< Estimated bandwidth (bytes/s)
+  uint32_t m_ackedInInterval; //!< Bytes acknowledged in this control interval
+  Time m_intervalStart;      //!< Start of this control interval
+};
+
+} // namespace ns3
+
+#endif /* RUDP_CONGESTION_OPS_H */
@@ -0,0 +1,368 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#include "ns3/log.h"
+#include "rudp-control-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RudpControlHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (RudpSackHeader);
+NS_OBJECT_ENSURE_REGISTERED (RudpNakHeader);
+NS_OBJECT_ENSURE_REGISTERED (RudpDropHeader);
+
+/* Most significant bit of a range list word: the word starts a range
+ * and the next word holds the last sequence number of that range.
+ */
+static const uint32_t RANGE_START_BIT = 0x80000000;
+
+/**
+ * \brief Number of 32-bit words needed to encode a range list
+ * \param ranges the range list
+ * \return the number of words
+ */
+static uint32_t
+GetRangeListWords (const RudpSequenceRangeList &ranges)
+{
+  uint32_t words = 0;
+  for (RudpSequenceRangeList::const_iterator it = ranges.begin (); it != ranges.end (); ++it)
+    {
+      words += (it->first == it->second) ? 1 : 2;
+    }
+  return words;
+}
+
+/**
+ * \brief Write a range list, preceded by its length in words
+ * \param i the buffer iterator
+ * \param ranges the range list
+ */
+static void
+SerializeRangeList (Buffer::Iterator &i, const RudpSequenceRangeList &ranges)
+{
+  i.WriteHtonU16 (GetRangeListWords (ranges));
+  for (RudpSequenceRangeList::const_iterator it = ranges.begin (); it != ranges.end (); ++it)
+    {
+      if (it->first == it->second)
+        {
+          i.WriteHtonU32 (it->first);
+        }
+      else
+        {
+          i.WriteHtonU32 (it->first | RANGE_START_BIT);
+          i.WriteHtonU32 (it->second);
+        }
+    }
+}
+
+/**
+ * \brief Read a range list written by SerializeRangeList
+ * \param i the buffer iterator
+ * \param ranges the range list to fill
+ * \return the number of bytes read
+ */
+static uint32_t
+DeserializeRangeList (Buffer::Iterator &i, RudpSequenceRangeList &ranges)
+{
+  ranges.clear ();
+  uint16_t words = i.ReadNtohU16 ();
+  uint16_t read = 0;
+  while (read < words)
+    {
+      uint32_t first = i.ReadNtohU32 ();
+      read++;
+      if ((first & RANGE_START_BIT) && read < words)
+        {
+          uint32_t last = i.ReadNtohU32 ();
+          read++;
+          ranges.push_back (RudpSequenceRange (first & ~RANGE_START_BIT, last));
+        }
+      else
+        {
+          first &= ~RANGE_START_BIT;
+          ranges.push_back (RudpSequenceRange (first, first));
+        }
+    }
+  return 2 + 4 * words;
+}
+
+RudpSackHeader::RudpSackHeader ()
+  : m_cumulativeAck (0),
+    m_connectionId (0),
+    m_window (0)
+{
+}
+
+RudpSackHeader::~RudpSackHeader ()
+{
+}
+
+void
+RudpSackHeader::SetCumulativeAck (uint32_t ack)
+{
+  m_cumulativeAck = ack;
+}
+
+uint32_t
+RudpSackHeader::GetCumulativeAck (void) const
+{
+  return m_cumulativeAck;
+}
+
+void
+RudpSackHeader::SetConnectionId (uint16_t connectionId)
+{
+  m_connectionId = connectionId;
+}
+
+uint16_t
+RudpSackHeader::GetConnectionId (void) const
+{
+  return m_connectionId;
+}
+
+void
+RudpSackHeader::SetWindow (uint32_t window)
+{
+  m_window = window;
+}
+
+uint32_t
+RudpSackHeader::GetWindow (void) const
+{
+  return m_window;
+}
+
+void
+RudpSackHeader::AddSackRange (uint32_t first, uint32_t last)
+{
+  m_sackRanges.push_back (RudpSequenceRange (first, last));
+}
+
+const RudpSequenceRangeList &
+RudpSackHeader::GetSackRanges (void) const
+{
+  return m_sackRanges;
+}
+
+TypeId
+RudpSackHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpSackHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpSackHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+RudpSackHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+RudpSackHeader::Print (std::ostream &os) const
+{
+  os << "ack: " << m_cumulativeAck << " connection id: " << m_connectionId
+     << " window: " << m_window << " sack:";
+  for (RudpSequenceRangeList::const_iterator it = m_sackRanges.begin (); it != m_sackRanges.end (); ++it)
+    {
+      os << " [" << it->first << "-" << it->second << "]";
+    }
+}
+
+uint32_t
+RudpSackHeader::GetSerializedSize (void) const
+{
+  return 4 + 2 + 4 + 2 + 4 * GetRangeListWords (m_sackRanges);
+}
+
+void
+RudpSackHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteHtonU32 (m_cumulativeAck);
+  i.WriteHtonU16 (m_connectionId);
+  i.WriteHtonU32 (m_window);
+  SerializeRangeList (i, m_sackRanges);
+}
+
+uint32_t
+RudpSackHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_cumulativeAck = i.ReadNtohU32 ();
+  m_connectionId = i.ReadNtohU16 ();
+  m_window = i.ReadNtohU32 ();
+  return 4 + 2 + 4 + DeserializeRangeList (i, m_sackRanges);
+}
+
+RudpNakHeader::RudpNakHeader ()
+{
+}
+
+RudpNakHeader::~RudpNakHeader ()
+{
+}
+
+void
+RudpNakHeader::AddLossRange (uint32_t first, uint32_t last)
+{
+  m_lossRanges.push_back (RudpSequenceRange (first, last));
+}
+
+const RudpSequenceRangeList &
+RudpNakHeader::GetLossRanges (void) const
+{
+  return m_lossRanges;
+}
+
+TypeId
+RudpNakHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpNakHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpNakHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+RudpNakHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+RudpNakHeader::Print (std::ostream &os) const
+{
+  os << "lost:";
+  for (RudpSequenceRangeList::const_iterator it = m_lossRanges.begin (); it != m_lossRanges.end (); ++it)
+    {
+      os << " [" << it->first << "-" << it->second << "]";
+    }
+}
+
+uint32_t
+RudpNakHeader::GetSerializedSize (void) const
+{
+  return 2 + 4 * GetRangeListWords (m_lossRanges);
+}
+
+void
+RudpNakHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  SerializeRangeList (i, m_lossRanges);
+}
+
+uint32_t
+RudpNakHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  return DeserializeRangeList (i, m_lossRanges);
+}
+
+RudpDropHeader::RudpDropHeader ()
+  : m_messageNumber (0),
+    m_dropRange (0, 0)
+{
+}
+
+RudpDropHeader::~RudpDropHeader ()
+{
+}
+
+void
+RudpDropHeader::SetMessageNumber (uint32_t messageNumber)
+{
+  m_messageNumber = messageNumber;
+}
+
+uint32_t
+RudpDropHeader::GetMessageNumber (void) const
+{
+  return m_messageNumber;
+}
+
+void
+RudpDropHeader::SetDropRange (uint32_t first, uint32_t last)
+{
+  m_dropRange = RudpSequenceRange (first, last);
+}
+
+const RudpSequenceRange &
+RudpDropHeader::GetDropRange (void) const
+{
+  return m_dropRange;
+}
+
+TypeId
+RudpDropHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpDropHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpDropHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+RudpDropHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+RudpDropHeader::Print (std::ostream &os) const
+{
+  os << "message: " << m_messageNumber
+     << " dropped: [" << m_dropRange.first << "-" << m_dropRange.second << "]";
+}
+
+uint32_t
+RudpDropHeader::GetSerializedSize (void) const
+{
+  return 4 + 4 + 4;
+}
+
+void
+RudpDropHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteHtonU32 (m_messageNumber);
+  i.WriteHtonU32 (m_dropRange.first);
+  i.WriteHtonU32 (m_dropRange.second);
+}
+
+uint32_t
+RudpDropHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_messageNumber = i.ReadNtohU32 ();
+  m_dropRange.first = i.ReadNtohU32 ();
+  m_dropRange.second = i.ReadNtohU32 ();
+  return GetSerializedSize ();
+}
+
+} // namespace ns3
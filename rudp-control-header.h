@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#ifndef RUDP_CONTROL_HEADER_H
+#define RUDP_CONTROL_HEADER_H
+
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include "ns3/header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup rudp
+ * \brief An inclusive range of sequence numbers [first, last]
+ */
+typedef std::pair<uint32_t, uint32_t> RudpSequenceRange;
+
+/**
+ * \ingroup rudp
+ * \brief A list of sequence number ranges, in sequence order
+ */
+typedef std::vector<RudpSequenceRange> RudpSequenceRangeList;
+
+/**
+ * \ingroup rudp
+ * \brief Payload of a SACK control packet
+ *
+ * Carries the cumulative acknowledgement (the next sequence number the
+ * receiver expects, everything before it has been received), the
+ * connection ID the peer may use in compact data headers (0 if none),
+ * the free space of the receive buffer in bytes and the ranges received
+ * above the cumulative acknowledgement.
+ *
+ * Ranges are compressed as in UDT loss lists: a range of a single
+ * sequence number takes one 32-bit word, a longer range is written as its
+ * first sequence number with the most significant bit set, followed by
+ * its last sequence number.
+ */
+class RudpSackHeader : public Header
+{
+public:
+  RudpSackHeader ();
+  virtual ~RudpSackHeader ();
+
+  /**
+   * \param ack the next sequence number expected by the receiver
+   */
+  void SetCumulativeAck (uint32_t ack);
+  /**
+   * \return the next sequence number expected by the receiver
+   */
+  uint32_t GetCumulativeAck (void) const;
+  /**
+   * \param connectionId the connection ID for compact data headers, 0 for none
+   */
+  void SetConnectionId (uint16_t connectionId);
+  /**
+   * \return the connection ID for compact data headers, 0 for none
+   */
+  uint16_t GetConnectionId (void) const;
+  /**
+   * \param window the free space of the receive buffer, in bytes
+   */
+  void SetWindow (uint32_t window);
+  /**
+   * \return the free space of the receive buffer, in bytes
+   */
+  uint32_t GetWindow (void) const;
+  /**
+   * \brief Append a received range, ranges must be added in sequence order
+   * \param first the first sequence number of the range
+   * \param last the last sequence number of the range
+   */
+  void AddSackRange (uint32_t first, uint32_t last);
+  /**
+   * \return the ranges received above the cumulative acknowledgement
+   */
+  const RudpSequenceRangeList & GetSackRanges (void) const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint32_t m_cumulativeAck;           //!< Next expected sequence number
+  uint16_t m_connectionId;            //!< Connection ID for compact headers
+  uint32_t m_window;                  //!< Free receive buffer space
+  RudpSequenceRangeList m_sackRanges; //!< Ranges received out of order
+};
+
+/**
+ * \ingroup rudp
+ * \brief Payload of a NAK control packet
+ *
+ * Carries the sequence ranges the receiver detected as lost, with the same
+ * range compression as RudpSackHeader, so that a single NAK can report a
+ * burst of thousands of lost packets in two words.
+ */
+class RudpNakHeader : public Header
+{
+public:
+  RudpNakHeader ();
+  virtual ~RudpNakHeader ();
+
+  /**
+   * \brief Append a lost range, ranges must be added in sequence order
+   * \param first the first lost sequence number
+   * \param last the last lost sequence number
+   */
+  void AddLossRange (uint32_t first, uint32_t last);
+  /**
+   * \return the lost ranges
+   */
+  const RudpSequenceRangeList & GetLossRanges (void) const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  RudpSequenceRangeList m_lossRanges; //!< Lost ranges
+};
+
+/**
+ * \ingroup rudp
+ * \brief Payload of a DROP control packet
+ *
+ * Sent when a message outlived its time-to-live before it was
+ * acknowledged: the sender no longer retransmits the sequence range, the
+ * receiver counts it as received and discards the fragments of the
+ * message it holds.
+ */
+class RudpDropHeader : public Header
+{
+public:
+  RudpDropHeader ();
+  virtual ~RudpDropHeader ();
+
+  /**
+   * \param messageNumber the number of the dropped message
+   */
+  void SetMessageNumber (uint32_t messageNumber);
+  /**
+   * \return the number of the dropped message
+   */
+  uint32_t GetMessageNumber (void) const;
+  /**
+   * \brief Set the sequence numbers no longer retransmitted
+   * \param first the first sequence number of the range
+   * \param last the last sequence number of the range
+   */
+  void SetDropRange (uint32_t first, uint32_t last);
+  /**
+   * \return the sequence numbers no longer retransmitted
+   */
+  const RudpSequenceRange & GetDropRange (void) const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint32_t m_messageNumber;       //!< Dropped message
+  RudpSequenceRange m_dropRange;  //!< Sequence numbers no longer retransmitted
+};
+
+} // namespace ns3
+
+#endif /* RUDP_CONTROL_HEADER_H */
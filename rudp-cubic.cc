@@ -0,0 +1,194 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "rudp-cubic.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RudpCubic");
+
+NS_OBJECT_ENSURE_REGISTERED (RudpCubic);
+
+TypeId
+RudpCubic::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpCubic")
+    .SetParent<RudpCongestionOps> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpCubic> ()
+    .AddAttribute ("InitialWindow", "Initial congestion window, in segments",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&RudpCubic::m_initialWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("C", "Scaling constant of the cubic function",
+                   DoubleValue (0.4),
+                   MakeDoubleAccessor (&RudpCubic::m_c),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Beta", "Share of the window kept after a congestion event",
+                   DoubleValue (0.7),
+                   MakeDoubleAccessor (&RudpCubic::m_beta),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("FastConvergence", "Release bandwidth faster when the window shrinks",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&RudpCubic::m_fastConvergence),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TcpFriendliness", "Grow at least as fast as AIMD would",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&RudpCubic::m_tcpFriendliness),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+RudpCubic::RudpCubic ()
+  : m_segmentSize (0),
+    m_cwnd (0),
+    m_ssThresh (std::numeric_limits<double>::max ()),
+    m_wMax (0),
+    m_wLastMax (0),
+    m_k (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+RudpCubic::~RudpCubic ()
+{
+}
+
+std::string
+RudpCubic::GetName (void) const
+{
+  return "RudpCubic";
+}
+
+void
+RudpCubic::SetSegmentSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  if (m_cwnd == 0)
+    {
+      m_cwnd = m_initialWindow;
+    }
+  m_segmentSize = size;
+}
+
+void
+RudpCubic::PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << ackedBytes << bytesInFlight);
+  double acked = static_cast<double> (ackedBytes) / m_segmentSize;
+  if (m_cwnd < m_ssThresh)
+    {
+      m_cwnd += acked;
+      return;
+    }
+
+  if (m_epochStart.IsZero ())
+    {
+      // First growth since slow start or a congestion event
+      m_epochStart = Simulator::Now ();
+      if (m_cwnd < m_wMax)
+        {
+          m_k = std::pow ((m_wMax - m_cwnd) / m_c, 1.0 / 3);
+        }
+      else
+        {
+          m_k = 0;
+          m_wMax = m_cwnd;
+        }
+    }
+
+  double target = GetCubicTarget ();
+  if (m_tcpFriendliness && !m_rtt.IsZero ())
+    {
+      // Window AIMD with the same average decrease would have reached
+      double t = (Simulator::Now () - m_epochStart).GetSeconds ();
+      double aimd = m_wMax * m_beta + 3 * (1 - m_beta) / (1 + m_beta) * t / m_rtt.GetSeconds ();
+      target = std::max (target, aimd);
+    }
+  if (target > m_cwnd)
+    {
+      // Reach the target over one RTT worth of acknowledgements
+      m_cwnd += (target - m_cwnd) / m_cwnd * acked;
+    }
+  else
+    {
+      // Barely grow in the flat region
+      m_cwnd += acked / (100 * m_cwnd);
+    }
+}
+
+double
+RudpCubic::GetCubicTarget (void) const
+{
+  double t = (Simulator::Now () - m_epochStart + m_rtt).GetSeconds () - m_k;
+  return m_c * t * t * t + m_wMax;
+}
+
+void
+RudpCubic::CongestionEvent (uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << bytesInFlight);
+  m_epochStart = Time (0);
+  if (m_fastConvergence && m_cwnd < m_wLastMax)
+    {
+      // The window shrank since the last event, leave room to newcomers
+      m_wLastMax = m_cwnd;
+      m_wMax = m_cwnd * (1 + m_beta) / 2;
+    }
+  else
+    {
+      m_wLastMax = m_cwnd;
+      m_wMax = m_cwnd;
+    }
+  m_cwnd = std::max (m_cwnd * m_beta, 2.0);
+  m_ssThresh = m_cwnd;
+  NS_LOG_LOGIC ("Window " << m_cwnd << " segments, wMax " << m_wMax);
+}
+
+void
+RudpCubic::RttSample (Time rtt)
+{
+  m_rtt = m_rtt.IsZero () ? rtt : (m_rtt * 7 + rtt) / 8;
+}
+
+void
+RudpCubic::Timeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_epochStart = Time (0);
+  m_ssThresh = std::max (m_cwnd * m_beta, 2.0);
+  m_wMax = m_cwnd;
+  m_cwnd = 1;
+}
+
+uint32_t
+RudpCubic::GetCongestionWindow (void) const
+{
+  return static_cast<uint32_t> (m_cwnd * m_segmentSize);
+}
+
+} // namespace ns3
@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#ifndef RUDP_CUBIC_H
+#define RUDP_CUBIC_H
+
+#include "rudp-congestion-ops.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup rudp
+ * \brief CUBIC congestion control (RFC 8312)
+ *
+ * After a congestion event the window grows along a cubic function of
+ * the time since the event, centred on the window the event happened
+ * at: fast at first, flat around that window, then fast again to probe
+ * for more. The growth does not depend on the RTT, so high-BDP paths get
+ * back to full rate sooner than with AIMD.
+ *
+ * Where AIMD would grow faster, on short RTTs, the window follows the
+ * AIMD estimate instead (TCP-friendly region), so that CUBIC shares
+ * bottlenecks fairly with TCP. With fast convergence, a flow losing
+ * bandwidth to newcomers releases more of it.
+ */
+class RudpCubic : public RudpCongestionOps
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  RudpCubic ();
+  virtual ~RudpCubic ();
+
+  virtual std::string GetName (void) const;
+  virtual void SetSegmentSize (uint32_t size);
+  virtual void PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight);
+  virtual void CongestionEvent (uint32_t bytesInFlight);
+  virtual void RttSample (Time rtt);
+  virtual void Timeout (void);
+  virtual uint32_t GetCongestionWindow (void) const;
+
+private:
+  /**
+   * \brief Get the window CUBIC aims at, one RTT from now
+   * \return the window, in segments
+   */
+  double GetCubicTarget (void) const;
+
+  uint32_t m_segmentSize;   //!< Largest payload of a data packet
+  uint32_t m_initialWindow; //!< Initial window, in segments
+  double m_c;               //!< Scaling constant of the cubic function
+  double m_beta;            //!< Window kept after a congestion event
+  bool m_fastConvergence;   //!< Release bandwidth faster when the window shrinks
+  bool m_tcpFriendliness;   //!< Grow at least as AIMD would
+  double m_cwnd;            //!< Congestion window, in segments
+  double m_ssThresh;        //!< Slow start threshold, in segments
+  double m_wMax;            //!< Window at the last congestion event, in segments
+  double m_wLastMax;        //!< m_wMax before the last congestion event, in segments
+  double m_k;               //!< Time the cubic function takes to get back to m_wMax (s)
+  Time m_epochStart;        //!< Start of the growth epoch, zero when none started
+  Time m_rtt;               //!< Smoothed RTT
+};
+
+} // namespace ns3
+
+#endif /* RUDP_CUBIC_H */
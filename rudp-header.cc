@@ -20,19 +20,159 @@
 
 #include "rudp-header.h"
 #include "ns3/address-utils.h"
+#include "ns3/packet.h"
+#include <algorithm>
+#include <cstring>
 
 namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (RudpHeader);
 
+/* Checksum kernel. The ones' complement sum does not depend on the byte
+ * order it is computed in (RFC 1071), so the data is summed as native
+ * 64-bit words and the checksum is stored back in memory order.
+ */
+
+/**
+ * \brief Add a contiguous block to a ones' complement sum
+ * \param sum the running sum
+ * \param data the block, starting at an even offset of the summed data
+ * \param size the size of the block
+ * \return the new running sum
+ */
+static uint64_t
+ChecksumAdd (uint64_t sum, const uint8_t *data, uint32_t size)
+{
+  while (size >= 8)
+    {
+      uint64_t word;
+      std::memcpy (&word, data, 8);
+      sum += (word & 0xffffffff) + (word >> 32);
+      data += 8;
+      size -= 8;
+    }
+  while (size >= 2)
+    {
+      uint16_t word;
+      std::memcpy (&word, data, 2);
+      sum += word;
+      data += 2;
+      size -= 2;
+    }
+  if (size)
+    {
+      uint16_t word = 0;
+      std::memcpy (&word, data, 1);
+      sum += word;
+    }
+  return sum;
+}
+
+/**
+ * \brief Add the bytes of a buffer to a ones' complement sum
+ * \param sum the running sum
+ * \param i iterator on the first byte, at an even offset of the summed data
+ * \param size the number of bytes
+ * \return the new running sum
+ */
+static uint64_t
+ChecksumAdd (uint64_t sum, Buffer::Iterator i, uint32_t size)
+{
+  uint8_t chunk[2048];
+  while (size > 0)
+    {
+      uint32_t n = std::min (size, (uint32_t) sizeof (chunk));
+      i.Read (chunk, n);
+      sum = ChecksumAdd (sum, chunk, n);
+      size -= n;
+    }
+  return sum;
+}
+
+/**
+ * \brief Fold a running sum to 16 bits
+ * \param sum the running sum
+ * \return the folded sum, not complemented, in host order
+ */
+static uint16_t
+ChecksumFold (uint64_t sum)
+{
+  while (sum >> 16)
+    {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
+  return static_cast<uint16_t> (sum);
+}
+
+/**
+ * \brief Sum of a 16-bit word given in network byte order
+ * \param hi the first byte
+ * \param lo the second byte
+ * \return the word as summed by ChecksumAdd
+ */
+static uint16_t
+ChecksumWord (uint8_t hi, uint8_t lo)
+{
+  uint8_t bytes[2] = { hi, lo };
+  uint16_t word;
+  std::memcpy (&word, bytes, 2);
+  return word;
+}
+
+/* Big endian field accessors for the on-stack copy of the header */
+
+static void
+WriteBe16 (uint8_t *p, uint16_t v)
+{
+  p[0] = v >> 8;
+  p[1] = v & 0xff;
+}
+
+static void
+WriteBe32 (uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = (v >> 16) & 0xff;
+  p[2] = (v >> 8) & 0xff;
+  p[3] = v & 0xff;
+}
+
+static uint16_t
+ReadBe16 (const uint8_t *p)
+{
+  return ((uint16_t) p[0] << 8) | p[1];
+}
+
+static uint32_t
+ReadBe32 (const uint8_t *p)
+{
+  return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
 /* The magic values below are used only for debugging.
  * They can be used to easily detect memory corruption
  * problems so you can see the patterns in memory.
  */
 RudpHeader::RudpHeader ()
-  : m_sourcePort (0xfffd),
+  : m_sequenceNumber (0),
+    m_messageNumber (0),
+    m_timestamp (0),
+    m_timestampEcho (0),
+    m_sourcePort (0xfffd),
     m_destinationPort (0xfffd),
     m_payloadSize (0),
+    m_connectionId (0),
+    m_pseudoHeaderSum (0),
+    m_payloadChecksum (0),
+    m_typeBits (0),
+    m_positionFlag (0),
+    m_inorderFlag (false),
+    m_controlFlag (false),
+    m_bundleFlag (false),
+    m_hasTimestamp (false),
+    m_calcChecksum (false),
+    m_goodChecksum (true),
+    m_hasPayloadChecksum (false)
 {
 }
 
@@ -43,6 +183,90 @@ RudpHeader::~RudpHeader ()
   m_payloadSize = 0xfffe;
 }
 
+void
+RudpHeader::EnableChecksums (void)
+{
+  m_calcChecksum = true;
+}
+
+void
+RudpHeader::InitializeChecksum (Address source,
+                                Address destination,
+                                uint8_t protocol)
+{
+  if (Ipv4Address::IsMatchingType (source))
+    {
+      InitializeChecksum (Ipv4Address::ConvertFrom (source),
+                          Ipv4Address::ConvertFrom (destination), protocol);
+    }
+  else if (Ipv6Address::IsMatchingType (source))
+    {
+      InitializeChecksum (Ipv6Address::ConvertFrom (source),
+                          Ipv6Address::ConvertFrom (destination), protocol);
+    }
+}
+
+void
+RudpHeader::InitializeChecksum (Ipv4Address source,
+                                Ipv4Address destination,
+                                uint8_t protocol)
+{
+  uint8_t addresses[8];
+  source.Serialize (addresses);
+  destination.Serialize (addresses + 4);
+  m_pseudoHeaderSum = ChecksumFold (ChecksumAdd (ChecksumWord (0, protocol), addresses, 8));
+}
+
+void
+RudpHeader::InitializeChecksum (Ipv6Address source,
+                                Ipv6Address destination,
+                                uint8_t protocol)
+{
+  // The upper bytes of the 32-bit length and next header fields are zero
+  uint8_t addresses[32];
+  source.Serialize (addresses);
+  destination.Serialize (addresses + 16);
+  m_pseudoHeaderSum = ChecksumFold (ChecksumAdd (ChecksumWord (0, protocol), addresses, 32));
+}
+
+void
+RudpHeader::SetPayloadChecksum (uint16_t payloadChecksum)
+{
+  m_hasPayloadChecksum = true;
+  m_payloadChecksum = payloadChecksum;
+}
+
+uint16_t
+RudpHeader::CalculatePayloadChecksum (Ptr<const Packet> payload)
+{
+  // Packet only copies out contiguous data from its start: sum it a
+  // chunk at a time through a copy sharing the buffer. Chunks hold an
+  // even number of bytes, so that the words stay aligned across them.
+  Ptr<Packet> rest = payload->Copy ();
+  uint8_t chunk[2048];
+  uint64_t sum = 0;
+  while (rest->GetSize () > 0)
+    {
+      uint32_t n = std::min (rest->GetSize (), (uint32_t) sizeof (chunk));
+      rest->CopyData (chunk, n);
+      rest->RemoveAtStart (n);
+      sum = ChecksumAdd (sum, chunk, n);
+    }
+  return ChecksumFold (sum);
+}
+
+uint16_t
+RudpHeader::CalculateHeaderChecksum (uint16_t size) const
+{
+  return ChecksumFold ((uint64_t) m_pseudoHeaderSum + ChecksumWord (size >> 8, size & 0xff));
+}
+
+bool
+RudpHeader::IsChecksumOk (void) const
+{
+  return m_goodChecksum;
+}
+
 void 
 RudpHeader::SetDestinationPort (uint16_t port)
 {
@@ -61,12 +285,12 @@ RudpHeader::SetControlFlag (bool controlFlag)
 void
 RudpHeader::SetPositionFlag (uint8_t positionFlag)
 {
-  m_positionFlag = positionFlag;
+  m_positionFlag = (positionFlag & 0x3);
 }
 void
 RudpHeader::SetTypeBits (uint8_t typeBits)
 {
-  m_typeBits = typeBits;
+  m_typeBits = (typeBits & 0x7);
 }
 void
 RudpHeader::SetInorderFlag (bool inorderFlag)
@@ -74,6 +298,11 @@ RudpHeader::SetInorderFlag (bool inorderFlag)
   m_inorderFlag = inorderFlag;
 }
 void
+RudpHeader::SetBundleFlag (bool bundleFlag)
+{
+  m_bundleFlag = bundleFlag;
+}
+void
 RudpHeader::SetSequenceNumber (uint32_t sequenceNumber)
 {
   m_sequenceNumber = (sequenceNumber & 0x7fffffff);
@@ -81,7 +310,19 @@ RudpHeader::SetSequenceNumber (uint32_t sequenceNumber)
 void
 RudpHeader::SetMessageNumber (uint32_t messageNumber)
 {
-  m_messageNumber = (messageNumber & 0x1ffffffff);
+  m_messageNumber = (messageNumber & MAX_MESSAGE_NUMBER);
+}
+void
+RudpHeader::SetConnectionId (uint16_t connectionId)
+{
+  m_connectionId = connectionId;
+}
+void
+RudpHeader::SetTimestamp (uint32_t value, uint32_t echo)
+{
+  m_hasTimestamp = true;
+  m_timestamp = value;
+  m_timestampEcho = echo;
 }
 uint16_t 
 RudpHeader::GetSourcePort (void) const
@@ -113,6 +354,11 @@ RudpHeader::GetInorderFlag (void) const
 {
   return m_inorderFlag;
 }
+bool
+RudpHeader::GetBundleFlag (void) const
+{
+  return m_bundleFlag;
+}
 uint32_t
 RudpHeader::GetSequenceNumber (void) const
 {
@@ -123,6 +369,75 @@ RudpHeader::GetMessageNumber (void) const
 {
   return m_messageNumber;
 }
+uint16_t
+RudpHeader::GetConnectionId (void) const
+{
+  return m_connectionId;
+}
+bool
+RudpHeader::IsCompact (void) const
+{
+  return !m_controlFlag && m_connectionId != 0;
+}
+bool
+RudpHeader::HasTimestamp (void) const
+{
+  return m_hasTimestamp;
+}
+uint32_t
+RudpHeader::GetTimestamp (void) const
+{
+  return m_timestamp;
+}
+uint32_t
+RudpHeader::GetTimestampEcho (void) const
+{
+  return m_timestampEcho;
+}
+
+uint32_t
+RudpHeader::IncrementSequence (uint32_t seq, uint32_t n)
+{
+  return (seq + n) & MAX_SEQUENCE_NUMBER;
+}
+
+int32_t
+RudpHeader::SequenceOffset (uint32_t from, uint32_t to)
+{
+  uint32_t diff = (to - from) & MAX_SEQUENCE_NUMBER;
+  if (diff > (MAX_SEQUENCE_NUMBER >> 1))
+    {
+      return static_cast<int32_t> (diff) - static_cast<int32_t> (MAX_SEQUENCE_NUMBER) - 1;
+    }
+  return static_cast<int32_t> (diff);
+}
+
+bool
+RudpHeader::SequenceLessThan (uint32_t a, uint32_t b)
+{
+  return SequenceOffset (a, b) > 0;
+}
+
+uint32_t
+RudpHeader::ExpandTruncated (uint32_t truncated, uint32_t expected,
+                             uint32_t mask, uint32_t space)
+{
+  // Of the numbers ending in the truncated bits, pick the nearest to expected
+  uint32_t best = ((expected & ~mask) | (truncated & mask)) & space;
+  uint32_t candidates[2] = { (best - mask - 1) & space, (best + mask + 1) & space };
+  uint32_t bestDistance = std::min ((best - expected) & space, (expected - best) & space);
+  for (uint32_t k = 0; k < 2; k++)
+    {
+      uint32_t distance = std::min ((candidates[k] - expected) & space,
+                                    (expected - candidates[k]) & space);
+      if (distance < bestDistance)
+        {
+          best = candidates[k];
+          bestDistance = distance;
+        }
+    }
+  return best;
+}
 
 void
 RudpHeader::ForcePayloadSize (uint16_t payloadSize)
@@ -162,70 +477,183 @@ RudpHeader::Print (std::ostream &os) const
      << ", "
      << " inorder flag: " << m_inorderFlag
      << ", "
-     << " type bits: " << m_typeBits
+     << " type bits: " << (uint32_t) m_typeBits
      << ", "
-     << " postion flag: " << m_positionFlag
+     << " postion flag: " << (uint32_t) m_positionFlag
+     << ", "
+     << " bundle flag: " << m_bundleFlag
   ;
+  if (IsCompact ())
+    {
+      os << ", connection id: " << m_connectionId;
+    }
+  if (m_hasTimestamp)
+    {
+      os << ", ts: " << m_timestamp << " ecr: " << m_timestampEcho;
+    }
 }
 
 uint32_t 
 RudpHeader::GetSerializedSize (void) const
 {
-  return 16;
+  uint32_t size = IsCompact () ? 10 : 16;
+  if (m_hasTimestamp)
+    {
+      size += 8;
+    }
+  return size;
 }
 
 void
 RudpHeader::Serialize (Buffer::Iterator start) const
 {
-  Buffer::Iterator i = start;
-
-  i.WriteHtonU16 (m_sourcePort);
-  i.WriteHtonU16 (m_destinationPort);
+  // The header is assembled on the stack and written in one go
+  uint8_t buf[MAX_HEADER_SIZE];
+  uint32_t size = start.GetRemainingSize ();
+  uint32_t hdrSize;
+  uint8_t *p = buf;
 
-  if (m_payloadSize == 0)
+  if (IsCompact ())
     {
-      i.WriteHtonU16 (start.GetSize ());
+      WriteBe16 (p, 0);
+      WriteBe16 (p + 2, m_connectionId);
+      WriteBe16 (p + 4, m_sequenceNumber & COMPACT_SEQUENCE_MASK);
+      WriteBe16 (p + 6, ((uint16_t) m_positionFlag << 14) | ((uint16_t) m_inorderFlag << 13)
+                 | ((uint16_t) m_hasTimestamp << 12) | ((uint16_t) m_bundleFlag << 11)
+                 | (m_messageNumber & COMPACT_MESSAGE_MASK));
+      hdrSize = 10;
     }
   else
     {
-      i.WriteHtonU16 (m_payloadSize);
+      WriteBe16 (p, m_sourcePort);
+      WriteBe16 (p + 2, m_destinationPort);
+      WriteBe16 (p + 4, m_payloadSize == 0 ? size : m_payloadSize);
+      WriteBe32 (p + 6, ((uint32_t) m_controlFlag << 31) | m_sequenceNumber);
+      if (m_controlFlag)
+        {
+          WriteBe32 (p + 10, ((uint32_t) m_typeBits << 29) | ((uint32_t) m_hasTimestamp << 28)
+                     | m_messageNumber);
+        }
+      else
+        {
+          WriteBe32 (p + 10, ((uint32_t) m_positionFlag << 30) | ((uint32_t) m_inorderFlag << 29)
+                     | ((uint32_t) m_hasTimestamp << 28) | ((uint32_t) m_bundleFlag << 27)
+                     | m_messageNumber);
+        }
+      hdrSize = 16;
     }
-  
-  i.WriteHtonU32 (((m_controlFlag<<31)|(m_sequenceNumber)));
+  // checksum, filled in below
+  uint8_t *checksumField = p + hdrSize - 2;
+  checksumField[0] = 0;
+  checksumField[1] = 0;
 
-  if(m_controlFlag)
-  {
-    i.WriteHtonU32 (((m_typeBits<<29)|(m_messageNumber)));
-  }
-  else
-  {
-    i.WriteHtonU32 (((m_positionFlag<<30)|(m_inorderFlag<<29)|(m_messageNumber)))
-  }
+  if (m_hasTimestamp)
+    {
+      WriteBe32 (p + hdrSize, m_timestamp);
+      WriteBe32 (p + hdrSize + 4, m_timestampEcho);
+      hdrSize += 8;
+    }
 
+  if (m_calcChecksum)
+    {
+      uint64_t sum = ChecksumAdd (CalculateHeaderChecksum (size), buf, hdrSize);
+      if (m_hasPayloadChecksum)
+        {
+          // Only the header changed since the payload was summed
+          sum += m_payloadChecksum;
+        }
+      else
+        {
+          Buffer::Iterator payload = start;
+          payload.Next (hdrSize);
+          sum = ChecksumAdd (sum, payload, size - hdrSize);
+        }
+      uint16_t checksum = ~ChecksumFold (sum);
+      if (checksum == 0)
+        {
+          // 0 means that no checksum was computed
+          checksum = 0xffff;
+        }
+      std::memcpy (checksumField, &checksum, 2);
+    }
+
+  start.Write (buf, hdrSize);
 }
 
 uint32_t
 RudpHeader::Deserialize (Buffer::Iterator start)
 {
+  uint8_t buf[MAX_HEADER_SIZE];
+  uint32_t size = start.GetRemainingSize ();
+  uint32_t hdrSize;
+  const uint8_t *checksumField;
   Buffer::Iterator i = start;
-  m_sourcePort = i.ReadNtohU16 ();
-  m_destinationPort = i.ReadNtohU16 ();
-  m_payloadSize = i.ReadNtohU16 () - GetSerializedSize ();
-  rudpSequenceNumber = i.ReadNtohU32 ();
-  rudpMessageNumber = i.ReadNtohU32 ();
-  m_controlFlag = (rudpSequenceNumber & 0x80000000);
-  m_sequenceNumber = (rudpSequenceNumber & 0x7fffffff);
-  m_messageNumber = (rudpMessageNumber & 0x1fffffff);
-  if(m_controlFlag)
-  {
-    m_typeBits = (rudpMessageNumber>>29);
-  }
+
+  // Both formats are at least as long as the compact one
+  i.Read (buf, 10);
+  m_sourcePort = ReadBe16 (buf);
+  if (m_sourcePort == 0)
+    {
+      // Compact data header, the ports are restored from the connection ID
+      m_connectionId = ReadBe16 (buf + 2);
+      m_destinationPort = 0;
+      m_controlFlag = false;
+      m_sequenceNumber = ReadBe16 (buf + 4);
+      uint16_t flags = ReadBe16 (buf + 6);
+      m_positionFlag = (flags >> 14);
+      m_inorderFlag = ((flags >> 13) & 1);
+      m_hasTimestamp = ((flags >> 12) & 1);
+      m_bundleFlag = ((flags >> 11) & 1);
+      m_messageNumber = (flags & COMPACT_MESSAGE_MASK);
+      hdrSize = 10;
+    }
   else
-  {
-    m_positionFlag = (rudpMessageNumber>>30);
-    m_inorderFlag = ((rudpMessageNumber>>29) & 1);
-  }
-  return GetSerializedSize ();
+    {
+      i.Read (buf + 10, 6);
+      m_connectionId = 0;
+      m_destinationPort = ReadBe16 (buf + 2);
+      m_payloadSize = ReadBe16 (buf + 4);
+      uint32_t rudpSequenceNumber = ReadBe32 (buf + 6);
+      uint32_t rudpMessageNumber = ReadBe32 (buf + 10);
+      m_controlFlag = (rudpSequenceNumber & 0x80000000) != 0;
+      m_sequenceNumber = (rudpSequenceNumber & MAX_SEQUENCE_NUMBER);
+      m_messageNumber = (rudpMessageNumber & MAX_MESSAGE_NUMBER);
+      m_hasTimestamp = ((rudpMessageNumber >> 28) & 1);
+      if (m_controlFlag)
+        {
+          m_typeBits = (rudpMessageNumber >> 29);
+          m_bundleFlag = false;
+        }
+      else
+        {
+          m_positionFlag = (rudpMessageNumber >> 30);
+          m_inorderFlag = ((rudpMessageNumber >> 29) & 1);
+          m_bundleFlag = ((rudpMessageNumber >> 27) & 1);
+        }
+      hdrSize = 16;
+    }
+  checksumField = buf + hdrSize - 2;
+
+  if (m_hasTimestamp)
+    {
+      i.Read (buf + hdrSize, 8);
+      m_timestamp = ReadBe32 (buf + hdrSize);
+      m_timestampEcho = ReadBe32 (buf + hdrSize + 4);
+      hdrSize += 8;
+    }
+  if (IsCompact ())
+    {
+      m_payloadSize = size;
+    }
+  m_payloadSize -= hdrSize;
+
+  if (m_calcChecksum && (checksumField[0] != 0 || checksumField[1] != 0))
+    {
+      uint64_t sum = ChecksumAdd (CalculateHeaderChecksum (size), buf, hdrSize);
+      m_goodChecksum = (ChecksumFold (ChecksumAdd (sum, i, size - hdrSize)) == 0xffff);
+    }
+
+  return hdrSize;
 }
 
 } // namespace ns3
@@ -24,22 +24,96 @@
 #include <stdint.h>
 #include <string>
 #include "ns3/header.h"
+#include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
 
 namespace ns3 {
+
+class Packet;
+
 /**
- * \ingroup udp
- * \brief Packet header for UDP packets
+ * \ingroup rudp
+ * \brief Packet header for RUDP packets
+ *
+ * This class has the fields of a UDP header (port numbers, payload size,
+ * checksum) followed by the RUDP ones (flags, sequence and message
+ * numbers) as well as methods for serialization to and deserialization
+ * from a byte buffer.
+ *
+ * Data packets of an established flow may use a compact 10-byte format
+ * instead: a zero word (never a valid source port), a connection ID
+ * allocated by the receiver, the low 16 bits of the sequence number, the
+ * data flags with the low 11 bits of the message number and the checksum. The receiver maps
+ * the connection ID back to the ports and expands the truncated numbers
+ * against the ones it expects. The compact format is used whenever a
+ * non-zero connection ID is set on a data packet.
+ *
+ * The checksum is the ones' complement sum of an IP pseudo-header, the
+ * RUDP header and the payload, as for UDP. It is computed a machine word at
+ * a time and can be skipped (checksum offload) through
+ * Node::ChecksumEnabled. As retransmissions resend an unchanged payload,
+ * the payload part of the sum can be computed once with
+ * CalculatePayloadChecksum and handed back with SetPayloadChecksum.
  *
- * This class has fields corresponding to those in a network UDP header
- * (port numbers, payload size, checksum) as well as methods for serialization
- * to and deserialization from a byte buffer.
+ * Either format may be followed by the timestamp option: the sender's
+ * clock in microseconds and the timestamp echoed back to the peer, flagged
+ * by the bit following the in-order flag (or the type bits). The clock of
+ * a control packet is the arrival time of the packet it echoes.
+ *
+ * The bit following the timestamp flag of a data packet is the bundle
+ * flag: the payload is then a sequence of small messages, each preceded
+ * by a RudpChunkHeader, and the message number of the header is the one
+ * of the last message.
  */
 class RudpHeader : public Header 
 {
 public:
 
+  /**
+   * \brief Control packet types, carried in the type bits of a
+   * control packet
+   */
+  typedef enum
+  {
+    SACK = 1,   //!< Cumulative ACK plus selectively received ranges
+    NAK = 2,    //!< Sequence ranges detected lost by the receiver
+    DROP = 3,   //!< Message the sender gave up on, to be skipped by the receiver
+  } ControlType_t;
+
+  /**
+   * \brief Position of the payload of a data packet in its message,
+   * carried in the position flags
+   */
+  typedef enum
+  {
+    MIDDLE = 0, //!< Neither the first nor the last fragment
+    LAST = 1,   //!< Last fragment of the message
+    FIRST = 2,  //!< First fragment of the message
+    SOLO = 3,   //!< The whole message
+  } PositionFlag_t;
+
+  /**
+   * \brief Largest sequence number, sequence numbers are 31 bits long
+   */
+  static const uint32_t MAX_SEQUENCE_NUMBER = 0x7fffffff;
+  /**
+   * \brief Largest message number, message numbers are 27 bits long
+   */
+  static const uint32_t MAX_MESSAGE_NUMBER = 0x07ffffff;
+  /**
+   * \brief Mask of the sequence number bits carried by the compact format
+   */
+  static const uint32_t COMPACT_SEQUENCE_MASK = 0xffff;
+  /**
+   * \brief Mask of the message number bits carried by the compact format
+   */
+  static const uint32_t COMPACT_MESSAGE_MASK = 0x07ff;
+  /**
+   * \brief Size of the largest header, the full format with the timestamp option
+   */
+  static const uint32_t MAX_HEADER_SIZE = 24;
+
   /**
    * \brief Constructor
    *
@@ -49,11 +123,78 @@ public:
   ~RudpHeader ();
 
   /**
-   * \param port the destination port for this UdpHeader
+   * \brief Enable checksum calculation for RUDP
+   */
+  void EnableChecksums (void);
+  /**
+   * \param source the ip source to use in the underlying
+   *        ip packet.
+   * \param destination the ip destination to use in the
+   *        underlying ip packet.
+   * \param protocol the protocol number to use in the underlying
+   *        ip packet.
+   *
+   * If you want to use RUDP checksums, you should call this
+   * method prior to adding the header to a packet.
+   */
+  void InitializeChecksum (Address source,
+                           Address destination,
+                           uint8_t protocol);
+  /**
+   * \param source the ip source to use in the underlying
+   *        ip packet.
+   * \param destination the ip destination to use in the
+   *        underlying ip packet.
+   * \param protocol the protocol number to use in the underlying
+   *        ip packet.
+   *
+   * If you want to use RUDP checksums, you should call this
+   * method prior to adding the header to a packet.
+   */
+  void InitializeChecksum (Ipv4Address source,
+                           Ipv4Address destination,
+                           uint8_t protocol);
+  /**
+   * \param source the ip source to use in the underlying
+   *        ip packet.
+   * \param destination the ip destination to use in the
+   *        underlying ip packet.
+   * \param protocol the protocol number to use in the underlying
+   *        ip packet.
+   *
+   * If you want to use RUDP checksums, you should call this
+   * method prior to adding the header to a packet.
+   */
+  void InitializeChecksum (Ipv6Address source,
+                           Ipv6Address destination,
+                           uint8_t protocol);
+  /**
+   * \brief Is the RUDP checksum correct ?
+   * \returns true if the checksum is correct, false otherwise.
+   */
+  bool IsChecksumOk (void) const;
+  /**
+   * \brief Reuse a precomputed sum of the payload
+   *
+   * Serialize then only sums the pseudo-header and the header itself.
+   *
+   * \param payloadChecksum the value returned by CalculatePayloadChecksum
+   * for the payload this header is added to
+   */
+  void SetPayloadChecksum (uint16_t payloadChecksum);
+  /**
+   * \brief Sum a payload for SetPayloadChecksum
+   * \param payload the payload, without RUDP header
+   * \return the ones' complement sum of the payload, not complemented
+   */
+  static uint16_t CalculatePayloadChecksum (Ptr<const Packet> payload);
+
+  /**
+   * \param port the destination port for this RudpHeader
    */
   void SetDestinationPort (uint16_t port);
   /**
-   * \param port The source port for this UdpHeader
+   * \param port The source port for this RudpHeader
    */
   void SetSourcePort (uint16_t port);
   /**
@@ -61,18 +202,22 @@ public:
   */
   void SetControlFlag (bool controlBit);
   /**
-  * \param pfBit Position flag for a data packet
+  * \param positionFlag Position flag for a data packet
   */
   void SetPositionFlag (uint8_t positionFlag);
   /**
-  * \/param typeBit Type bits for a controle packet
+  * \param typeBits Type bits for a control packet
   */
   void SetTypeBits (uint8_t typeBits);
-  /*
+  /**
   * \param inorderBit True if packets should be sent in order
   */
   void SetInorderFlag (bool inorderBit);
   /**
+  * \param bundleFlag true if the payload is a sequence of chunks
+  */
+  void SetBundleFlag (bool bundleFlag);
+  /**
   * \param sequenceNumber The sequence number for the payload
   */
   void SetSequenceNumber (uint32_t sequenceNumber);
@@ -81,11 +226,22 @@ public:
   */
   void SetMessageNumber (uint32_t messageNumber);
   /**
-   * \return The source port for this UdpHeader
+   * \param connectionId the receiver's connection ID, a non-zero value
+   * selects the compact format for data packets
+   */
+  void SetConnectionId (uint16_t connectionId);
+  /**
+   * \brief Add the timestamp option
+   * \param value the sender's clock, in microseconds
+   * \param echo the latest timestamp received from the peer
+   */
+  void SetTimestamp (uint32_t value, uint32_t echo);
+  /**
+   * \return The source port for this RudpHeader
    */
   uint16_t GetSourcePort (void) const;
   /**
-   * \return the destination port for this UdpHeader
+   * \return the destination port for this RudpHeader
    */
   uint16_t GetDestinationPort (void) const;
   /**
@@ -97,14 +253,18 @@ public:
   */
   uint8_t GetPositionFlag (void) const;
   /**
-  * \return typeBit Type bits for a controle packet
+  * \return typeBit Type bits for a control packet
   */
   uint8_t GetTypeBits (void) const;
-  /*
+  /**
   * \return inorderBit True if packets should be sent in order
   */
   bool GetInorderFlag (void) const;
   /**
+  * \return true if the payload is a sequence of chunks
+  */
+  bool GetBundleFlag (void) const;
+  /**
   * \return the sequence number of the packet
   */
   uint32_t GetSequenceNumber (void) const;
@@ -112,6 +272,62 @@ public:
   * \return the message number of the packet if the payload is fragmented
   */
   uint32_t GetMessageNumber (void) const;
+  /**
+  * \return the connection ID, 0 if the packet is not in the compact format
+  */
+  uint16_t GetConnectionId (void) const;
+  /**
+  * \return true if the header uses the compact format
+  *
+  * Sequence and message numbers of a compact header are truncated to
+  * COMPACT_SEQUENCE_MASK and COMPACT_MESSAGE_MASK and have to be expanded by
+  * the receiver, the ports are not carried at all.
+  */
+  bool IsCompact (void) const;
+  /**
+  * \return true if the header carries the timestamp option
+  */
+  bool HasTimestamp (void) const;
+  /**
+  * \return the sender's clock when the packet was sent, in microseconds
+  */
+  uint32_t GetTimestamp (void) const;
+  /**
+  * \return the timestamp echoed back by the sender
+  */
+  uint32_t GetTimestampEcho (void) const;
+  /**
+   * \brief Expand a truncated number against the one expected
+   * \param truncated the truncated number
+   * \param expected the number expected by the receiver
+   * \param mask the mask the number was truncated with
+   * \param space the mask of the full number space
+   * \return the number closest to expected whose low bits are truncated
+   */
+  static uint32_t ExpandTruncated (uint32_t truncated, uint32_t expected,
+                                   uint32_t mask, uint32_t space);
+
+  /**
+   * \brief Advance a sequence number, wrapping around the 31 bit space
+   * \param seq the sequence number
+   * \param n the number of steps to advance
+   * \return the advanced sequence number
+   */
+  static uint32_t IncrementSequence (uint32_t seq, uint32_t n = 1);
+  /**
+   * \brief Signed distance between two sequence numbers
+   * \param from the first sequence number
+   * \param to the second sequence number
+   * \return how many steps 'to' is ahead of 'from' (negative if behind)
+   */
+  static int32_t SequenceOffset (uint32_t from, uint32_t to);
+  /**
+   * \brief Wrap-aware comparison of two sequence numbers
+   * \param a the first sequence number
+   * \param b the second sequence number
+   * \return true if a comes before b
+   */
+  static bool SequenceLessThan (uint32_t a, uint32_t b);
 
   /**
    * \brief Get the type ID.
@@ -125,7 +341,7 @@ public:
   virtual uint32_t Deserialize (Buffer::Iterator start);
 
   /**
-   * \brief Force the UDP payload length to a given value.
+   * \brief Force the RUDP payload length to a given value.
    *
    * This might be useful when forging a packet for test
    * purposes.
@@ -135,23 +351,35 @@ public:
   void ForcePayloadSize (uint16_t payloadSize);
 
 private:
+  /**
+   * \brief Calculate the sum of the IP pseudo-header
+   * \param size the size of the RUDP header and payload
+   * \return the ones' complement sum, not complemented
+   */
+  uint16_t CalculateHeaderChecksum (uint16_t size) const;
+
+  // Largest fields first, no padding: a header is created for every packet
+  uint32_t m_sequenceNumber;  //!< Sequence number
+  uint32_t m_messageNumber;   //!< Message number (additional info for control packets)
+  uint32_t m_timestamp;       //!< Timestamp value
+  uint32_t m_timestampEcho;   //!< Timestamp echo
   uint16_t m_sourcePort;      //!< Source port
   uint16_t m_destinationPort; //!< Destination port
   uint16_t m_payloadSize;     //!< Payload size
-
-  uint32_t m_sequenceNumber;
-  uint32_t m_messageNumber;
-  uint8_t m_typeBits;
-  uint8_t m_postionFlag;
-  bool m_inOrderFlag;
-  bool m_controlFlag;
-   
-
-  Address m_source;           //!< Source IP address
-  Address m_destination;      //!< Destination IP address
-  uint8_t m_protocol;         //!< Protocol number
+  uint16_t m_connectionId;    //!< Connection ID of a compact header
+  uint16_t m_pseudoHeaderSum; //!< Sum of the IP pseudo-header, without the length
+  uint16_t m_payloadChecksum; //!< Precomputed sum of the payload
+  uint8_t m_typeBits;         //!< Control packet type
+  uint8_t m_positionFlag;     //!< Position of the payload in its message
+  bool m_inorderFlag;         //!< Message must be delivered in order
+  bool m_controlFlag;         //!< Control (true) or data (false) packet
+  bool m_bundleFlag;          //!< Payload made of several chunks
+  bool m_hasTimestamp;        //!< Timestamp option present
+  bool m_calcChecksum;        //!< Flag to calculate checksum
+  bool m_goodChecksum;        //!< Flag to indicate that checksum is correct
+  bool m_hasPayloadChecksum;  //!< m_payloadChecksum is set
 };
 
 } // namespace ns3
 
-#endif /* UDP_HEADER */
+#endif /* RUDP_HEADER_H */
@@ -65,7 +65,8 @@ RudpL4Protocol::GetTypeId (void)
 }
 
 RudpL4Protocol::RudpL4Protocol ()
-  : m_endPoints (new Ipv4EndPointDemux ()), m_endPoints6 (new Ipv6EndPointDemux ())
+  : m_endPoints (new Ipv4EndPointDemux ()), m_endPoints6 (new Ipv6EndPointDemux ()),
+    m_nextConnectionId (1)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -150,6 +151,7 @@ RudpL4Protocol::DoDispose (void)
       delete m_endPoints6;
       m_endPoints6 = 0;
     }
+  m_connections.clear ();
   m_node = 0;
   m_downTarget.Nullify ();
   m_downTarget6.Nullify ();
@@ -256,6 +258,45 @@ RudpL4Protocol::DeAllocate (Ipv6EndPoint *endPoint)
   m_endPoints6->DeAllocate (endPoint);
 }
 
+uint16_t
+RudpL4Protocol::AllocateConnectionId (uint16_t localPort, uint16_t peerPort)
+{
+  NS_LOG_FUNCTION (this << localPort << peerPort);
+  // 0 means no connection ID, so at most 0xffff can be in use
+  if (m_connections.size () >= 0xffff)
+    {
+      return 0;
+    }
+  while (m_nextConnectionId == 0 || m_connections.find (m_nextConnectionId) != m_connections.end ())
+    {
+      m_nextConnectionId++;
+    }
+  uint16_t connectionId = m_nextConnectionId++;
+  m_connections[connectionId] = ConnectionPorts (localPort, peerPort);
+  return connectionId;
+}
+
+void
+RudpL4Protocol::DeAllocateConnectionId (uint16_t connectionId)
+{
+  NS_LOG_FUNCTION (this << connectionId);
+  m_connections.erase (connectionId);
+}
+
+bool
+RudpL4Protocol::RestorePorts (RudpHeader &rudpHeader) const
+{
+  std::map<uint16_t, ConnectionPorts>::const_iterator it = m_connections.find (rudpHeader.GetConnectionId ());
+  if (it == m_connections.end ())
+    {
+      NS_LOG_LOGIC ("Unknown connection id " << rudpHeader.GetConnectionId ());
+      return false;
+    }
+  rudpHeader.SetDestinationPort (it->second.first);
+  rudpHeader.SetSourcePort (it->second.second);
+  return true;
+}
+
 void 
 RudpL4Protocol::ReceiveIcmp (Ipv4Address icmpSource, uint8_t icmpTtl,
                             uint8_t icmpType, uint8_t icmpCode, uint32_t icmpInfo,
@@ -337,6 +378,12 @@ RudpL4Protocol::Receive (Ptr<Packet> packet,
       return IpL4Protocol::RX_CSUM_FAILED;
     }
 
+  if (rudpHeader.IsCompact () && !RestorePorts (rudpHeader))
+    {
+      NS_LOG_LOGIC ("RX_ENDPOINT_UNREACH");
+      return IpL4Protocol::RX_ENDPOINT_UNREACH;
+    }
+
   NS_LOG_DEBUG ("Looking up dst " << header.GetDestination () << " port " << rudpHeader.GetDestinationPort ()); 
   Ipv4EndPointDemux::EndPoints endPoints =
     m_endPoints->Lookup (header.GetDestination (), rudpHeader.GetDestinationPort (),
@@ -359,7 +406,8 @@ RudpL4Protocol::Receive (Ptr<Packet> packet,
       return IpL4Protocol::RX_ENDPOINT_UNREACH;
     }
 
-  packet->RemoveHeader(rudpHeader);
+  // The RUDP header is left on the packet, the socket needs its
+  // sequencing fields and removes it in RudpSocketImpl::ForwardUp
   for (Ipv4EndPointDemux::EndPointsI endPoint = endPoints.begin ();
        endPoint != endPoints.end (); endPoint++)
     {
@@ -383,7 +431,7 @@ RudpL4Protocol::Receive (Ptr<Packet> packet,
 
   rudpHeader.InitializeChecksum (header.GetSourceAddress (), header.GetDestinationAddress (), PROT_NUMBER);
 
-  packet->RemoveHeader (rudpHeader);
+  packet->PeekHeader (rudpHeader);
 
   if(!rudpHeader.IsChecksumOk () && !header.GetSourceAddress ().IsIpv4MappedAddress ())
     {
@@ -391,6 +439,12 @@ RudpL4Protocol::Receive (Ptr<Packet> packet,
       return IpL4Protocol::RX_CSUM_FAILED;
     }
 
+  if (rudpHeader.IsCompact () && !RestorePorts (rudpHeader))
+    {
+      NS_LOG_LOGIC ("RX_ENDPOINT_UNREACH");
+      return IpL4Protocol::RX_ENDPOINT_UNREACH;
+    }
+
   NS_LOG_DEBUG ("Looking up dst " << header.GetDestinationAddress () << " port " << rudpHeader.GetDestinationPort ()); 
   Ipv6EndPointDemux::EndPoints endPoints =
     m_endPoints6->Lookup (header.GetDestinationAddress (), rudpHeader.GetDestinationPort (),
@@ -415,30 +469,27 @@ RudpL4Protocol::Send (Ptr<Packet> packet,
 {
   NS_LOG_FUNCTION (this << packet << saddr << daddr << sport << dport);
 
-  RudpHeader rudpHeader;
-  if(Node::ChecksumEnabled ())
-    {
-      rudpHeader.EnableChecksums ();
-      rudpHeader.InitializeChecksum (saddr,
-                                    daddr,
-                                    PROT_NUMBER);
-    }
-  rudpHeader.SetDestinationPort (dport);
-  rudpHeader.SetSourcePort (sport);
+  Send (packet, saddr, daddr, sport, dport, RudpHeader (), 0);
+}
 
-  packet->AddHeader (rudpHeader);
+void
+RudpL4Protocol::Send (Ptr<Packet> packet, 
+                     Ipv4Address saddr, Ipv4Address daddr, 
+                     uint16_t sport, uint16_t dport, Ptr<Ipv4Route> route)
+{
+  NS_LOG_FUNCTION (this << packet << saddr << daddr << sport << dport << route);
 
-  m_downTarget (packet, saddr, daddr, PROT_NUMBER, 0);
+  Send (packet, saddr, daddr, sport, dport, RudpHeader (), route);
 }
 
 void
 RudpL4Protocol::Send (Ptr<Packet> packet, 
                      Ipv4Address saddr, Ipv4Address daddr, 
-                     uint16_t sport, uint16_t dport, Ptr<Ipv4Route> route)
+                     uint16_t sport, uint16_t dport,
+                     RudpHeader rudpHeader, Ptr<Ipv4Route> route)
 {
   NS_LOG_FUNCTION (this << packet << saddr << daddr << sport << dport << route);
 
-  RudpHeader rudpHeader;
   if(Node::ChecksumEnabled ())
     {
       rudpHeader.EnableChecksums ();
@@ -461,30 +512,27 @@ RudpL4Protocol::Send (Ptr<Packet> packet,
 {
   NS_LOG_FUNCTION (this << packet << saddr << daddr << sport << dport);
 
-  RudpHeader rudpHeader;
-  if(Node::ChecksumEnabled ())
-    {
-      rudpHeader.EnableChecksums ();
-      rudpHeader.InitializeChecksum (saddr,
-                                    daddr,
-                                    PROT_NUMBER);
-    }
-  rudpHeader.SetDestinationPort (dport);
-  rudpHeader.SetSourcePort (sport);
+  Send (packet, saddr, daddr, sport, dport, RudpHeader (), 0);
+}
 
-  packet->AddHeader (rudpHeader);
+void
+RudpL4Protocol::Send (Ptr<Packet> packet,
+                     Ipv6Address saddr, Ipv6Address daddr,
+                     uint16_t sport, uint16_t dport, Ptr<Ipv6Route> route)
+{
+  NS_LOG_FUNCTION (this << packet << saddr << daddr << sport << dport << route);
 
-  m_downTarget6 (packet, saddr, daddr, PROT_NUMBER, 0);
+  Send (packet, saddr, daddr, sport, dport, RudpHeader (), route);
 }
 
 void
 RudpL4Protocol::Send (Ptr<Packet> packet,
                      Ipv6Address saddr, Ipv6Address daddr,
-                     uint16_t sport, uint16_t dport, Ptr<Ipv6Route> route)
+                     uint16_t sport, uint16_t dport,
+                     RudpHeader rudpHeader, Ptr<Ipv6Route> route)
 {
   NS_LOG_FUNCTION (this << packet << saddr << daddr << sport << dport << route);
 
-  RudpHeader rudpHeader;
   if(Node::ChecksumEnabled ())
     {
       rudpHeader.EnableChecksums ();
@@ -22,6 +22,7 @@
 #define RUDP_L4_PROTOCOL_H
 
 #include <stdint.h>
+#include <map>
 
 #include "ns3/packet.h"
 #include "ns3/ipv4-address.h"
@@ -30,6 +31,7 @@
 #include "ns3/ip-l4-protocol.h"
 #include "ipv6-interface.h"
 #include "ipv6-header.h"
+#include "rudp-header.h"
 
 namespace ns3 {
 
@@ -152,6 +154,23 @@ public:
    */
   void DeAllocate (Ipv6EndPoint *endPoint);
 
+  /**
+   * \brief Allocate a connection ID for compact data headers
+   *
+   * Compact headers do not carry ports, received ones are demultiplexed
+   * with the ports registered here.
+   *
+   * \param localPort the port of the receiving socket
+   * \param peerPort the port of the sending peer
+   * \return the connection ID, 0 if none is available
+   */
+  uint16_t AllocateConnectionId (uint16_t localPort, uint16_t peerPort);
+  /**
+   * \brief Release a connection ID
+   * \param connectionId the connection ID
+   */
+  void DeAllocateConnectionId (uint16_t connectionId);
+
   // called by RudpSocket.
   /**
    * \brief Send a packet via RUDP (IPv4)
@@ -199,6 +218,42 @@ public:
   void Send (Ptr<Packet> packet,
              Ipv6Address saddr, Ipv6Address daddr, 
              uint16_t sport, uint16_t dport, Ptr<Ipv6Route> route);
+  /**
+   * \brief Send a packet via RUDP (IPv4) with the given RUDP header fields
+   *
+   * The ports (and checksum) of rudpHeader are filled in by this method,
+   * all other fields are sent as set by the caller.
+   *
+   * \param packet The packet to send
+   * \param saddr The source Ipv4Address
+   * \param daddr The destination Ipv4Address
+   * \param sport The source port number
+   * \param dport The destination port number
+   * \param rudpHeader The RUDP header to send the packet with
+   * \param route The route
+   */
+  void Send (Ptr<Packet> packet,
+             Ipv4Address saddr, Ipv4Address daddr,
+             uint16_t sport, uint16_t dport,
+             RudpHeader rudpHeader, Ptr<Ipv4Route> route);
+  /**
+   * \brief Send a packet via RUDP (IPv6) with the given RUDP header fields
+   *
+   * The ports (and checksum) of rudpHeader are filled in by this method,
+   * all other fields are sent as set by the caller.
+   *
+   * \param packet The packet to send
+   * \param saddr The source Ipv6Address
+   * \param daddr The destination Ipv6Address
+   * \param sport The source port number
+   * \param dport The destination port number
+   * \param rudpHeader The RUDP header to send the packet with
+   * \param route The route
+   */
+  void Send (Ptr<Packet> packet,
+             Ipv6Address saddr, Ipv6Address daddr,
+             uint16_t sport, uint16_t dport,
+             RudpHeader rudpHeader, Ptr<Ipv6Route> route);
 
   // inherited from Ipv4L4Protocol
   virtual enum IpL4Protocol::RxStatus Receive (Ptr<Packet> p,
@@ -232,6 +287,13 @@ protected:
    */
   virtual void NotifyNewAggregate ();
 private:
+  /**
+   * \brief Fill in the ports of a compact header from its connection ID
+   * \param rudpHeader the compact header
+   * \return false if the connection ID is unknown
+   */
+  bool RestorePorts (RudpHeader &rudpHeader) const;
+
   Ptr<Node> m_node; //!< the node this stack is associated with
   Ipv4EndPointDemux *m_endPoints; //!< A list of IPv4 end points.
   Ipv6EndPointDemux *m_endPoints6; //!< A list of IPv6 end points.
@@ -254,6 +316,10 @@ private:
   IpL4Protocol::DownTargetCallback m_downTarget;   //!< Callback to send packets over IPv4
   IpL4Protocol::DownTargetCallback6 m_downTarget6; //!< Callback to send packets over IPv6
 
+  typedef std::pair<uint16_t, uint16_t> ConnectionPorts; //!< Local and peer port of a connection
+  std::map<uint16_t, ConnectionPorts> m_connections; //!< Connections using compact headers, by ID
+  uint16_t m_nextConnectionId;                       //!< Next connection ID to try
+
 };
 
 } // namespace ns3
@@ -0,0 +1,177 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "rudp-ledbat.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RudpLedbat");
+
+NS_OBJECT_ENSURE_REGISTERED (RudpLedbat);
+
+TypeId
+RudpLedbat::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpLedbat")
+    .SetParent<RudpCongestionOps> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpLedbat> ()
+    .AddAttribute ("Target", "Queueing delay aimed at",
+                   TimeValue (MilliSeconds (25)),
+                   MakeTimeAccessor (&RudpLedbat::m_target),
+                   MakeTimeChecker (MicroSeconds (1)))
+    .AddAttribute ("Gain", "Window growth per RTT without queueing delay, in segments",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&RudpLedbat::m_gain),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("InitialWindow", "Initial congestion window, in segments",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&RudpLedbat::m_initialWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MinWindow", "Smallest congestion window, in segments",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&RudpLedbat::m_minWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("AllowedIncrease", "Segments the window may exceed the data in flight by",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&RudpLedbat::m_allowedIncrease),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BaseHistory", "Minutes the base delay is the lowest delay of",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&RudpLedbat::m_baseHistory),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("CurrentFilter", "Samples the current delay is the lowest of",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&RudpLedbat::m_currentFilter),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+RudpLedbat::RudpLedbat ()
+  : m_segmentSize (0),
+    m_cwnd (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+RudpLedbat::~RudpLedbat ()
+{
+}
+
+std::string
+RudpLedbat::GetName (void) const
+{
+  return "RudpLedbat";
+}
+
+void
+RudpLedbat::SetSegmentSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  if (m_cwnd == 0)
+    {
+      m_cwnd = m_initialWindow * size;
+    }
+  m_segmentSize = size;
+}
+
+void
+RudpLedbat::ForwardDelaySample (Time delay)
+{
+  Time now = Simulator::Now ();
+  if (m_baseDelays.empty ())
+    {
+      m_baseDelays.push_back (delay);
+      m_baseRollover = now;
+    }
+  else if (now - m_baseRollover >= Minutes (1))
+    {
+      // A new minute, forget the oldest one
+      m_baseDelays.push_back (delay);
+      if (m_baseDelays.size () > m_baseHistory)
+        {
+          m_baseDelays.erase (m_baseDelays.begin ());
+        }
+      m_baseRollover = now;
+    }
+  else if (delay < m_baseDelays.back ())
+    {
+      m_baseDelays.back () = delay;
+    }
+
+  m_currentDelays.push_back (delay);
+  if (m_currentDelays.size () > m_currentFilter)
+    {
+      m_currentDelays.pop_front ();
+    }
+}
+
+Time
+RudpLedbat::GetBaseDelay (void) const
+{
+  return *std::min_element (m_baseDelays.begin (), m_baseDelays.end ());
+}
+
+void
+RudpLedbat::PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << ackedBytes << bytesInFlight);
+  if (m_currentDelays.empty ())
+    {
+      return;
+    }
+  Time current = *std::min_element (m_currentDelays.begin (), m_currentDelays.end ());
+  Time queueingDelay = current - GetBaseDelay ();
+  // Grow below the target, shrink above it, in proportion to the distance
+  double offTarget = (m_target - queueingDelay).GetSeconds () / m_target.GetSeconds ();
+  m_cwnd += m_gain * offTarget * ackedBytes * m_segmentSize / m_cwnd;
+
+  double maxWindow = bytesInFlight + ackedBytes + m_allowedIncrease * m_segmentSize;
+  m_cwnd = std::max (std::min (m_cwnd, maxWindow), static_cast<double> (m_minWindow * m_segmentSize));
+  NS_LOG_LOGIC ("Queueing delay " << queueingDelay.GetMilliSeconds () << " ms, window " << m_cwnd);
+}
+
+void
+RudpLedbat::CongestionEvent (uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << bytesInFlight);
+  m_cwnd = std::max (m_cwnd / 2, static_cast<double> (m_minWindow * m_segmentSize));
+}
+
+void
+RudpLedbat::Timeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  // RFC 6817 collapses to one packet, but never below the floor the
+  // window keeps everywhere else
+  m_cwnd = m_minWindow * m_segmentSize;
+}
+
+uint32_t
+RudpLedbat::GetCongestionWindow (void) const
+{
+  return static_cast<uint32_t> (m_cwnd);
+}
+
+} // namespace ns3
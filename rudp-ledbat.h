@@ -0,0 +1,87 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: 
+ */
+
+#ifndef RUDP_LEDBAT_H
+#define RUDP_LEDBAT_H
+
+#include <deque>
+#include <vector>
+#include "rudp-congestion-ops.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup rudp
+ * \brief LEDBAT lower-than-best-effort congestion control (RFC 6817)
+ *
+ * The controller measures the one-way delay of the data packets, and
+ * takes the lowest delay of the last minutes as the path's base delay:
+ * anything above it is queueing. The window grows while the queueing
+ * delay is below the target, and shrinks in proportion as soon as it
+ * rises above, so the flow backs off before loss-based flows see any
+ * change and only uses spare capacity.
+ *
+ * The one-way delay comes from the timestamp option: the peer's
+ * timestamp on a SACK minus the timestamp of ours it echoes. The clock
+ * offset between the two hosts cancels out with the base delay. Without
+ * timestamps the controller never grows its window.
+ */
+class RudpLedbat : public RudpCongestionOps
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  RudpLedbat ();
+  virtual ~RudpLedbat ();
+
+  virtual std::string GetName (void) const;
+  virtual void SetSegmentSize (uint32_t size);
+  virtual void PacketsAcked (uint32_t ackedBytes, uint32_t bytesInFlight);
+  virtual void CongestionEvent (uint32_t bytesInFlight);
+  virtual void ForwardDelaySample (Time delay);
+  virtual void Timeout (void);
+  virtual uint32_t GetCongestionWindow (void) const;
+
+private:
+  /**
+   * \brief Get the lowest delay of the base history
+   * \return the base delay
+   */
+  Time GetBaseDelay (void) const;
+
+  uint32_t m_segmentSize;     //!< Largest payload of a data packet
+  uint32_t m_initialWindow;   //!< Initial window, in segments
+  uint32_t m_minWindow;       //!< Smallest window, in segments
+  Time m_target;              //!< Queueing delay aimed at
+  double m_gain;              //!< Window growth per RTT at zero queueing delay, in segments
+  uint32_t m_allowedIncrease; //!< Segments the window may exceed the data in flight by
+  uint32_t m_baseHistory;     //!< Minutes of base delay history
+  uint32_t m_currentFilter;   //!< Samples the current delay is the lowest of
+  double m_cwnd;              //!< Congestion window, in bytes
+  std::vector<Time> m_baseDelays; //!< Lowest delay of each of the last minutes, the last is the current one
+  Time m_baseRollover;        //!< Start of the current minute
+  std::deque<Time> m_currentDelays; //!< Last delay samples
+};
+
+} // namespace ns3
+
+#endif /* RUDP_LEDBAT_H */
@@ -28,17 +28,29 @@
 #include "ns3/ipv6.h"
 #include "ns3/ipv6-l3-protocol.h"
 #include "ns3/ipv4-header.h"
+#include "ns3/icmpv4.h"
+#include "ns3/icmpv6-header.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv6-routing-protocol.h"
+#include "ns3/nstime.h"
 #include "ns3/rudp-socket-factory.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/ipv4-packet-info-tag.h"
 #include "ns3/ipv6-packet-info-tag.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/simulator.h"
+#include "ns3/object-factory.h"
 #include "rudp-socket-impl.h"
 #include "rudp-l4-protocol.h"
+#include "rudp-control-header.h"
+#include "rudp-chunk-header.h"
 #include "ipv4-end-point.h"
 #include "ipv6-end-point.h"
 #include <limits>
+#include <cstring>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -51,6 +63,17 @@ NS_OBJECT_ENSURE_REGISTERED (RudpSocketImpl);
 // \todo MAX_IPV4_UDP_DATAGRAM_SIZE is correct only for IPv4
 static const uint32_t MAX_IPV4_RUDP_DATAGRAM_SIZE = 65507; //!< Maximum RUDP datagram size
 
+// Initial number of slots of the retransmission ring, a power of two
+static const uint32_t INITIAL_TX_RING_SIZE = 64; //!< Initial retransmission ring size
+
+// Window assumed until the peer advertises its own, as TCP without window scaling
+static const uint32_t INITIAL_PEER_WINDOW = 65535; //!< Initial peer window (bytes)
+
+// Fragments waiting for reassembly are copied into chains of fixed-size
+// slots, taken from a per-socket pool
+static const uint32_t FRAGMENT_SLOT_SIZE = 512; //!< Reassembly slot size (bytes)
+static const uint32_t NO_FRAGMENT_SLOT = 0xffffffff; //!< End of a slot chain
+
 // Add attributes generic to all UdpSockets to base class UdpSocket
 TypeId
 RudpSocketImpl::GetTypeId (void)
@@ -63,6 +86,14 @@ RudpSocketImpl::GetTypeId (void)
                      "Drop RUDP packet due to receive buffer overflow",
                      MakeTraceSourceAccessor (&RudpSocketImpl::m_dropTrace),
                      "ns3::Packet::TracedCallback")
+    .AddTraceSource ("RTT",
+                     "Last RTT sample",
+                     MakeTraceSourceAccessor (&RudpSocketImpl::m_lastRtt),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("RTO",
+                     "Retransmission timeout",
+                     MakeTraceSourceAccessor (&RudpSocketImpl::m_rto),
+                     "ns3::TracedValueCallback::Time")
     .AddAttribute ("IcmpCallback", "Callback invoked whenever an icmp error is received on this socket.",
                    CallbackValue (),
                    MakeCallbackAccessor (&RudpSocketImpl::m_icmpCallback),
@@ -71,6 +102,54 @@ RudpSocketImpl::GetTypeId (void)
                    CallbackValue (),
                    MakeCallbackAccessor (&RudpSocketImpl::m_icmpCallback6),
                    MakeCallbackChecker ())
+    .AddAttribute ("ReorderWindow",
+                   "Time a packet may arrive after packets sent later, "
+                   "as a fraction of the lowest RTT, before it is deemed lost",
+                   DoubleValue (0.25),
+                   MakeDoubleAccessor (&RudpSocketImpl::m_reorderWindowFactor),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("TailLossProbe",
+                   "Resend the last packet two RTTs after the last ACK, "
+                   "instead of waiting for the retransmission timeout",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&RudpSocketImpl::m_tailLossProbe),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxSackRanges", "Maximum number of received ranges carried by a SACK",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&RudpSocketImpl::m_maxSackRanges),
+                   MakeUintegerChecker<uint32_t> (0, 256))
+    .AddAttribute ("Pacing",
+                   "Spread new data over the RTT instead of sending it as the window opens, "
+                   "new data is always paced at the rate the congestion controller sets, if any",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RudpSocketImpl::m_pacing),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PacingBurst", "Bytes of new data sent back to back before the pacer waits",
+                   UintegerValue (2800),
+                   MakeUintegerAccessor (&RudpSocketImpl::m_pacingBurst),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("InitialRto", "Retransmission timeout until the first RTT sample",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&RudpSocketImpl::m_initialRto),
+                   MakeTimeChecker ())
+    .AddAttribute ("MinRto", "Lowest retransmission timeout",
+                   TimeValue (MilliSeconds (200)),
+                   MakeTimeAccessor (&RudpSocketImpl::m_minRto),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxRto", "Highest retransmission timeout, exponential backoff included",
+                   TimeValue (Seconds (60)),
+                   MakeTimeAccessor (&RudpSocketImpl::m_maxRto),
+                   MakeTimeChecker ())
+    .AddAttribute ("ClockGranularity", "Clock granularity used in the retransmission timeout",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&RudpSocketImpl::m_clockGranularity),
+                   MakeTimeChecker ())
+    .AddAttribute ("RouteCacheTimeout",
+                   "How long a route looked up for a destination is reused, "
+                   "zero to look up the route of every packet",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&RudpSocketImpl::m_routeCacheTimeout),
+                   MakeTimeChecker (Seconds (0)))
   ;
   return tid;
 }
@@ -79,12 +158,45 @@ RudpSocketImpl::RudpSocketImpl ()
   : m_endPoint (0),
     m_endPoint6 (0),
     m_node (0),
-    m_udp (0),
+    m_rudp (0),
     m_errno (ERROR_NOTERROR),
     m_shutdownSend (false),
     m_shutdownRecv (false),
     m_connected (false),
-    m_rxAvailable (0)
+    m_rxAvailable (0),
+    m_nextTxSeq (0),
+    m_nextMessageNumber (0),
+    m_txRing (INITIAL_TX_RING_SIZE),
+    m_txRingMask (INITIAL_TX_RING_SIZE - 1),
+    m_txFirstSeq (0),
+    m_rxNextSeq (0),
+    m_rxHighSeq (0),
+    m_rxMessageNumber (0),
+    m_rxConnectionId (0),
+    m_peerConnectionId (0),
+    m_bytesInFlight (0),
+    m_peerWindow (INITIAL_PEER_WINDOW),
+    m_peerWindowAck (0),
+    m_advertisedWindow (0),
+    m_sendQueueBytes (0),
+    m_pathMtuPayloadSize (std::numeric_limits<uint32_t>::max ()),
+    m_freeFragmentSlot (NO_FRAGMENT_SLOT),
+    m_reassemblyBytes (0),
+    m_reorderBytes (0),
+    m_peerTimestamps (true),
+    m_tsRecentValid (false),
+    m_tsRecent (0),
+    m_tsRecentArrival (0),
+    m_rtoBackoff (0),
+    m_probeOutstanding (false),
+    m_pendingAcks (0),
+    m_ackCount (1),
+    m_ackWindowArrivals (0),
+    m_bundle (0),
+    m_bundleMessageNumber (0),
+    m_bundleMessageBytes (0),
+    m_recoverySeq (0),
+    m_paceBurstBytes (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -93,6 +205,10 @@ RudpSocketImpl::~RudpSocketImpl ()
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  m_ackEvent.Cancel ();
+  m_bundleEvent.Cancel ();
+  m_paceEvent.Cancel ();
+  m_retxEvent.Cancel ();
   m_node = 0;
   /**
    * Note: actually this function is called AFTER
@@ -129,6 +245,12 @@ RudpSocketImpl::~RudpSocketImpl ()
       m_rudp->DeAllocate (m_endPoint6);
       NS_ASSERT (m_endPoint6 == 0);
     }
+  if (m_rxConnectionId != 0)
+    {
+      NS_ASSERT (m_rudp != 0);
+      m_rudp->DeAllocateConnectionId (m_rxConnectionId);
+      m_rxConnectionId = 0;
+    }
   m_rudp = 0;
 }
 
@@ -197,6 +319,11 @@ RudpSocketImpl::DeallocateEndPoint (void)
       m_rudp->DeAllocate (m_endPoint6);
       m_endPoint6 = 0;
     }
+  if (m_rxConnectionId != 0)
+    {
+      m_rudp->DeAllocateConnectionId (m_rxConnectionId);
+      m_rxConnectionId = 0;
+    }
 }
 
 int
@@ -318,6 +445,8 @@ int
 RudpSocketImpl::ShutdownSend (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  // Messages already accepted still go out
+  FlushBundle ();
   m_shutdownSend = true;
   return 0;
 }
@@ -348,6 +477,20 @@ RudpSocketImpl::Close (void)
       return -1;
     }
   Ipv6LeaveGroup ();
+  if (m_ackEvent.IsRunning ())
+    {
+      // Flush the delayed ACK while the endpoint is still there
+      SendAck (m_ackPeer);
+    }
+  FlushBundle ();
+  if (!m_sendQueue.empty ())
+    {
+      NS_LOG_LOGIC ("Discarding " << m_sendQueue.size () << " messages not sent yet");
+      m_sendQueue.clear ();
+      m_sendQueueBytes = 0;
+    }
+  m_paceEvent.Cancel ();
+  m_retxEvent.Cancel ();
   m_shutdownRecv = true;
   m_shutdownSend = true;
   DeallocateEndPoint ();
@@ -360,6 +503,11 @@ RudpSocketImpl::Connect (const Address & address)
   NS_LOG_FUNCTION (this << address);
   if (InetSocketAddress::IsMatchingType(address) == true)
     {
+      if (!MatchPeer (address))
+        {
+          m_errno = ERROR_ISCONN;
+          return -1;
+        }
       InetSocketAddress transport = InetSocketAddress::ConvertFrom (address);
       m_defaultAddress = Address(transport.GetIpv4 ());
       m_defaultPort = transport.GetPort ();
@@ -368,6 +516,11 @@ RudpSocketImpl::Connect (const Address & address)
     }
   else if (Inet6SocketAddress::IsMatchingType(address) == true)
     {
+      if (!MatchPeer (address))
+        {
+          m_errno = ERROR_ISCONN;
+          return -1;
+        }
       Inet6SocketAddress transport = Inet6SocketAddress::ConvertFrom (address);
       m_defaultAddress = Address(transport.GetIpv6 ());
       m_defaultPort = transport.GetPort ();
@@ -501,11 +654,17 @@ RudpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv4Address dest, uint16_t port)
       return -1;
     }
 
-  if (p->GetSize () > GetTxAvailable () )
+  if (p->GetSize () > m_sndBufSize)
     {
       m_errno = ERROR_MSGSIZE;
       return -1;
     }
+  if (p->GetSize () > GetTxAvailable ())
+    {
+      NS_LOG_LOGIC ("Send buffer full");
+      m_errno = ERROR_AGAIN;
+      return -1;
+    }
 
   if (IsManualIpTos ())
     {
@@ -514,8 +673,6 @@ RudpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv4Address dest, uint16_t port)
       p->AddPacketTag (ipTosTag);
     }
 
-  Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4> ();
-
   if (IsManualIpTtl () && GetIpTtl () != 0 && !dest.IsMulticast () && !dest.IsBroadcast ())
     {
       SocketIpTtlTag tag;
@@ -539,33 +696,38 @@ RudpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv4Address dest, uint16_t port)
       }
   }
   
+  if (QueueMessage (p, InetSocketAddress (dest, port)) < 0)
+    {
+      return -1;
+    }
+  NotifySend (GetTxAvailable ());
+  return p->GetSize ();
+}
+
+int
+RudpSocketImpl::SendPacket (Ptr<Packet> p, const RudpHeader &header, Ipv4Address dest, uint16_t port)
+{
+  NS_LOG_FUNCTION (this << p << dest << port);
+  Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4> ();
+  RudpHeader rudpHeader = header;
+  AddTimestamp (rudpHeader);
+
   if (m_endPoint->GetLocalAddress () != Ipv4Address::GetAny ())
     {
       m_rudp->Send (p->Copy (), m_endPoint->GetLocalAddress (), dest,
-                   m_endPoint->GetLocalPort (), port, 0);
-      NotifyDataSent (p->GetSize ());
-      NotifySend (GetTxAvailable ());
-      return p->GetSize ();
+                   m_endPoint->GetLocalPort (), port, rudpHeader, 0);
+      return 0;
     }
   else if (ipv4->GetRoutingProtocol () != 0)
     {
-      Ipv4Header header;
-      header.SetDestination (dest);
-      header.SetProtocol (UdpL4Protocol::PROT_NUMBER);
       Socket::SocketErrno errno_;
-      Ptr<Ipv4Route> route;
-      Ptr<NetDevice> oif = m_boundnetdevice; //specify non-zero if bound to a specific device
-      // TBD-- we could cache the route and just check its validity
-      route = ipv4->GetRoutingProtocol ()->RouteOutput (p, header, oif, errno_); 
+      Ptr<Ipv4Route> route = LookupRoute (p, dest, errno_);
       if (route != 0)
         {
           NS_LOG_LOGIC ("Route exists");
-
-          header.SetSource (route->GetSource ());
-          m_rudp->Send (p->Copy (), header.GetSource (), header.GetDestination (),
-                       m_endPoint->GetLocalPort (), port, route);
-          NotifyDataSent (p->GetSize ());
-          return p->GetSize ();
+          m_rudp->Send (p->Copy (), route->GetSource (), dest,
+                       m_endPoint->GetLocalPort (), port, rudpHeader, route);
+          return 0;
         }
       else 
         {
@@ -613,11 +775,17 @@ RudpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv6Address dest, uint16_t port)
       return -1;
     }
 
-  if (p->GetSize () > GetTxAvailable () )
+  if (p->GetSize () > m_sndBufSize)
     {
       m_errno = ERROR_MSGSIZE;
       return -1;
     }
+  if (p->GetSize () > GetTxAvailable ())
+    {
+      NS_LOG_LOGIC ("Send buffer full");
+      m_errno = ERROR_AGAIN;
+      return -1;
+    }
 
     if (IsManualIpv6Tclass ())
     {
@@ -626,9 +794,6 @@ RudpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv6Address dest, uint16_t port)
       p->AddPacketTag (ipTclassTag);
     }
 
-  Ptr<Ipv6> ipv6 = m_node->GetObject<Ipv6> ();
-
-  
   if (IsManualIpv6HopLimit () && GetIpv6HopLimit () != 0 && !dest.IsMulticast ())
     {
       SocketIpv6HopLimitTag tag;
@@ -636,32 +801,42 @@ RudpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv6Address dest, uint16_t port)
       p->AddPacketTag (tag);
     }
 
+  if (QueueMessage (p, Inet6SocketAddress (dest, port)) < 0)
+    {
+      return -1;
+    }
+  NotifySend (GetTxAvailable ());
+  return p->GetSize ();
+}
+
+int
+RudpSocketImpl::SendPacket (Ptr<Packet> p, const RudpHeader &header, Ipv6Address dest, uint16_t port)
+{
+  NS_LOG_FUNCTION (this << p << dest << port);
+  if (dest.IsIpv4MappedAddress ())
+    {
+      return SendPacket (p, header, dest.GetIpv4MappedAddress (), port);
+    }
+  Ptr<Ipv6> ipv6 = m_node->GetObject<Ipv6> ();
+  RudpHeader rudpHeader = header;
+  AddTimestamp (rudpHeader);
+
   if (m_endPoint6->GetLocalAddress () != Ipv6Address::GetAny ())
     {
       m_rudp->Send (p->Copy (), m_endPoint6->GetLocalAddress (), dest,
-                   m_endPoint6->GetLocalPort (), port, 0);
-      NotifyDataSent (p->GetSize ());
-      NotifySend (GetTxAvailable ());
-      return p->GetSize ();
+                   m_endPoint6->GetLocalPort (), port, rudpHeader, 0);
+      return 0;
     }
   else if (ipv6->GetRoutingProtocol () != 0)
     {
-      Ipv6Header header;
-      header.SetDestinationAddress (dest);
-      header.SetNextHeader (UdpL4Protocol::PROT_NUMBER);
       Socket::SocketErrno errno_;
-      Ptr<Ipv6Route> route;
-      Ptr<NetDevice> oif = m_boundnetdevice; //specify non-zero if bound to a specific device
-      // TBD-- we could cache the route and just check its validity
-      route = ipv6->GetRoutingProtocol ()->RouteOutput (p, header, oif, errno_); 
+      Ptr<Ipv6Route> route = LookupRoute (p, dest, errno_);
       if (route != 0)
         {
           NS_LOG_LOGIC ("Route exists");
-          header.SetSourceAddress (route->GetSource ());
-          m_rudp->Send (p->Copy (), header.GetSourceAddress (), header.GetDestinationAddress (),
-                       m_endPoint6->GetLocalPort (), port, route);
-          NotifyDataSent (p->GetSize ());
-          return p->GetSize ();
+          m_rudp->Send (p->Copy (), route->GetSource (), dest,
+                       m_endPoint6->GetLocalPort (), port, rudpHeader, route);
+          return 0;
         }
       else 
         {
@@ -681,290 +856,2036 @@ RudpSocketImpl::DoSendTo (Ptr<Packet> p, Ipv6Address dest, uint16_t port)
   return 0;
 }
 
-uint32_t
-RudpSocketImpl::GetTxAvailable (void) const
+Ptr<Ipv4Route>
+RudpSocketImpl::LookupRoute (Ptr<Packet> p, Ipv4Address dest, Socket::SocketErrno &errno_)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  // No finite send buffer is modelled, but we must respect
-  // the maximum size of an IP datagram (65535 bytes - headers).
-  return MAX_IPV4_RUDP_DATAGRAM_SIZE;
+  NS_LOG_FUNCTION (this << p << dest);
+  Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4> ();
+  std::map<Ipv4Address, Ipv4RouteCacheEntry>::iterator it = m_ipv4RouteCache.find (dest);
+  if (it != m_ipv4RouteCache.end ())
+    {
+      // Routing protocols do not report their changes: trust the route
+      // until it expires, as long as its interface and source address hold
+      Ptr<Ipv4Route> route = it->second.m_route;
+      int32_t interface = ipv4->GetInterfaceForDevice (route->GetOutputDevice ());
+      if (Simulator::Now () < it->second.m_expiry && interface >= 0 && ipv4->IsUp (interface)
+          && ipv4->GetInterfaceForAddress (route->GetSource ()) >= 0)
+        {
+          return route;
+        }
+      NS_LOG_LOGIC ("Cached route to " << dest << " is stale");
+      m_ipv4RouteCache.erase (it);
+    }
+
+  Ipv4Header header;
+  header.SetDestination (dest);
+  header.SetProtocol (RudpL4Protocol::PROT_NUMBER);
+  Ptr<NetDevice> oif = m_boundnetdevice; //specify non-zero if bound to a specific device
+  Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol ()->RouteOutput (p, header, oif, errno_);
+  // A loopback gateway is an on-demand protocol holding the packet while
+  // it discovers the route, it is not a route
+  if (route != 0 && !m_routeCacheTimeout.IsZero () && route->GetGateway () != Ipv4Address::GetLoopback ())
+    {
+      Ipv4RouteCacheEntry entry;
+      entry.m_route = route;
+      entry.m_expiry = Simulator::Now () + m_routeCacheTimeout;
+      m_ipv4RouteCache[dest] = entry;
+    }
+  return route;
 }
 
-int 
-RudpSocketImpl::SendTo (Ptr<Packet> p, uint32_t flags, const Address &address)
+Ptr<Ipv6Route>
+RudpSocketImpl::LookupRoute (Ptr<Packet> p, Ipv6Address dest, Socket::SocketErrno &errno_)
 {
-  NS_LOG_FUNCTION (this << p << flags << address);
-  if (InetSocketAddress::IsMatchingType (address))
-    {
-      if (IsManualIpTos ())
+  NS_LOG_FUNCTION (this << p << dest);
+  Ptr<Ipv6> ipv6 = m_node->GetObject<Ipv6> ();
+  std::map<Ipv6Address, Ipv6RouteCacheEntry>::iterator it = m_ipv6RouteCache.find (dest);
+  if (it != m_ipv6RouteCache.end ())
+    {
+      // Routing protocols do not report their changes: trust the route
+      // until it expires, as long as its interface and source address hold
+      Ptr<Ipv6Route> route = it->second.m_route;
+      int32_t interface = ipv6->GetInterfaceForDevice (route->GetOutputDevice ());
+      if (Simulator::Now () < it->second.m_expiry && interface >= 0 && ipv6->IsUp (interface)
+          && ipv6->GetInterfaceForAddress (route->GetSource ()) >= 0)
         {
-          SocketIpTosTag ipTosTag;
-          ipTosTag.SetTos (GetIpTos ());
-          p->AddPacketTag (ipTosTag);
+          return route;
         }
+      NS_LOG_LOGIC ("Cached route to " << dest << " is stale");
+      m_ipv6RouteCache.erase (it);
+    }
 
+  Ipv6Header header;
+  header.SetDestinationAddress (dest);
+  header.SetNextHeader (RudpL4Protocol::PROT_NUMBER);
+  Ptr<NetDevice> oif = m_boundnetdevice; //specify non-zero if bound to a specific device
+  Ptr<Ipv6Route> route = ipv6->GetRoutingProtocol ()->RouteOutput (p, header, oif, errno_);
+  // A loopback gateway is an on-demand protocol holding the packet while
+  // it discovers the route, it is not a route
+  if (route != 0 && !m_routeCacheTimeout.IsZero () && route->GetGateway () != Ipv6Address::GetLoopback ())
+    {
+      Ipv6RouteCacheEntry entry;
+      entry.m_route = route;
+      entry.m_expiry = Simulator::Now () + m_routeCacheTimeout;
+      m_ipv6RouteCache[dest] = entry;
+    }
+  return route;
+}
+
+void
+RudpSocketImpl::FlushRouteCache (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_ipv4RouteCache.clear ();
+  m_ipv6RouteCache.clear ();
+}
+
+int
+RudpSocketImpl::SendPacket (Ptr<Packet> p, const RudpHeader &rudpHeader, const Address &address)
+{
+  NS_LOG_FUNCTION (this << p << address);
+  if (InetSocketAddress::IsMatchingType (address))
+    {
       InetSocketAddress transport = InetSocketAddress::ConvertFrom (address);
-      Ipv4Address ipv4 = transport.GetIpv4 ();
-      uint16_t port = transport.GetPort ();
-      return DoSendTo (p, ipv4, port);
+      return SendPacket (p, rudpHeader, transport.GetIpv4 (), transport.GetPort ());
     }
   else if (Inet6SocketAddress::IsMatchingType (address))
     {
-      if (IsManualIpv6Tclass ())
-        {
-          SocketIpv6TclassTag ipTclassTag;
-          ipTclassTag.SetTclass (GetIpv6Tclass ());
-          p->AddPacketTag (ipTclassTag);
-        }
-
       Inet6SocketAddress transport = Inet6SocketAddress::ConvertFrom (address);
-      Ipv6Address ipv6 = transport.GetIpv6 ();
-      uint16_t port = transport.GetPort ();
-      return DoSendTo (p, ipv6, port);
+      return SendPacket (p, rudpHeader, transport.GetIpv6 (), transport.GetPort ());
     }
+  m_errno = ERROR_AFNOSUPPORT;
   return -1;
 }
 
-uint32_t
-RudpSocketImpl::GetRxAvailable (void) const
-{
-  NS_LOG_FUNCTION_NOARGS ();
-  // We separately maintain this state to avoid walking the queue 
-  // every time this might be called
-  return m_rxAvailable;
-}
-
-Ptr<Packet>
-RudpSocketImpl::Recv (uint32_t maxSize, uint32_t flags)
+int
+RudpSocketImpl::SendDataPacket (Ptr<Packet> p, RudpHeader &rudpHeader, const Address &address)
 {
-  NS_LOG_FUNCTION (this << maxSize << flags);
-  if (m_deliveryQueue.empty () )
+  NS_LOG_FUNCTION (this << p << address);
+  rudpHeader.SetSequenceNumber (m_nextTxSeq);
+  if (UseCompactHeader (address))
     {
-      m_errno = ERROR_AGAIN;
-      return 0;
+      rudpHeader.SetConnectionId (m_peerConnectionId);
     }
-  Ptr<Packet> p = m_deliveryQueue.front ();
-  if (p->GetSize () <= maxSize) 
+  if (Node::ChecksumEnabled ())
     {
-      m_deliveryQueue.pop ();
-      m_rxAvailable -= p->GetSize ();
+      // Summed once, retransmissions only checksum the header again
+      rudpHeader.SetPayloadChecksum (RudpHeader::CalculatePayloadChecksum (p));
     }
-  else
+  if (SendPacket (p, rudpHeader, address) < 0)
     {
-      p = 0; 
+      return -1;
     }
-  return p;
+  // Only what actually left is charged to the pacer and the controller
+  PaceSent (p->GetSize ());
+  m_congestion->PacketSent (p->GetSize (), m_bytesInFlight + p->GetSize ());
+  return 0;
 }
 
-Ptr<Packet>
-RudpSocketImpl::RecvFrom (uint32_t maxSize, uint32_t flags, 
-                         Address &fromAddress)
+bool
+RudpSocketImpl::MatchPeer (const Address &address)
 {
-  NS_LOG_FUNCTION (this << maxSize << flags);
-  Ptr<Packet> packet = Recv (maxSize, flags);
-  if (packet != 0)
+  if (m_peer.IsInvalid ())
     {
-      SocketAddressTag tag;
-      bool found;
-      found = packet->PeekPacketTag (tag);
-      NS_ASSERT (found);
-      fromAddress = tag.GetAddress ();
+      m_peer = address;
+      return true;
     }
-  return packet;
+  return address == m_peer;
+}
+
+uint32_t
+RudpSocketImpl::GetMaxPayloadSize (void) const
+{
+  return std::min (std::min (m_segmentSize, m_pathMtuPayloadSize),
+                   MAX_IPV4_RUDP_DATAGRAM_SIZE - RudpHeader::MAX_HEADER_SIZE);
 }
 
 int
-RudpSocketImpl::GetSockName (Address &address) const
+RudpSocketImpl::QueueMessage (Ptr<Packet> p, const Address &address)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  if (m_endPoint != 0)
+  NS_LOG_FUNCTION (this << p << address);
+  if (!MatchPeer (address))
     {
-      address = InetSocketAddress (m_endPoint->GetLocalAddress (), m_endPoint->GetLocalPort ());
+      NS_LOG_LOGIC ("Sequence spaces already shared with " << m_peer);
+      m_errno = ERROR_ISCONN;
+      return -1;
     }
-  else if (m_endPoint6 != 0)
+  // Messages larger than a packet are split into fragments sharing the
+  // message number, only the lost fragments are retransmitted
+  uint32_t messageNumber = m_nextMessageNumber;
+  Time expiry;
+  RudpMessageTtlTag ttlTag;
+  if (p->RemovePacketTag (ttlTag))
     {
-      address = Inet6SocketAddress (m_endPoint6->GetLocalAddress (), m_endPoint6->GetLocalPort ());
+      expiry = Simulator::Now () + ttlTag.GetTtl ();
     }
-  else
-    { // It is possible to call this method on a socket without a name
-      // in which case, behavior is unspecified
-      // Should this return an InetSocketAddress or an Inet6SocketAddress?
-      address = InetSocketAddress (Ipv4Address::GetZero (), 0);
+  uint32_t maxPayloadSize = GetMaxPayloadSize ();
+  uint32_t size = p->GetSize ();
+  uint32_t offset = 0;
+  do
+    {
+      uint32_t length = std::min (maxPayloadSize, size - offset);
+      uint8_t position = RudpHeader::MIDDLE;
+      if (offset == 0)
+        {
+          position |= RudpHeader::FIRST;
+        }
+      if (offset + length == size)
+        {
+          position |= RudpHeader::LAST;
+        }
+      Ptr<Packet> fragment = (position == RudpHeader::SOLO) ? p : p->CreateFragment (offset, length);
+
+      if (!m_sendQueue.empty () || !IsSendWindowOpen (length) || !IsPacingOpen ())
+        {
+          // Wait for the peer's window or the pacer, behind what is
+          // already waiting
+          NS_LOG_LOGIC ("Peer window full or paced, queueing");
+          PendingMessage pending;
+          pending.m_packet = fragment;
+          pending.m_destination = address;
+          pending.m_messageNumber = messageNumber;
+          pending.m_position = position;
+          pending.m_expiry = expiry;
+          m_sendQueue.push_back (pending);
+          m_sendQueueBytes += length;
+        }
+      else if (SendFragment (fragment, messageNumber, position, expiry, address, offset != 0) < 0)
+        {
+          return -1;
+        }
+      offset += length;
     }
+  while (offset < size);
+
+  m_nextMessageNumber = (messageNumber + 1) & RudpHeader::MAX_MESSAGE_NUMBER;
   return 0;
 }
 
 int
-RudpSocketImpl::GetPeerName (Address &address) const
+RudpSocketImpl::SendFragment (Ptr<Packet> p, uint32_t messageNumber, uint8_t position, Time expiry,
+                              const Address &address, bool accepted)
 {
-  NS_LOG_FUNCTION (this << address);
-
-  if (!m_connected)
+  NS_LOG_FUNCTION (this << p << messageNumber << (uint32_t) position << expiry << address << accepted);
+  if (position == RudpHeader::SOLO && m_messageBundling
+      && p->GetSize () + RudpChunkHeader::SIZE <= std::min (m_maxBundleSize, GetMaxPayloadSize ()))
     {
-      m_errno = ERROR_NOTCONN;
-      return -1;
+      AddToBundle (p, messageNumber, expiry, address);
+      return 0;
     }
+  // Keep the messages in the order they were sent
+  FlushBundle ();
 
-  if (Ipv4Address::IsMatchingType (m_defaultAddress))
-    {
-      Ipv4Address addr = Ipv4Address::ConvertFrom (m_defaultAddress);
-      address = InetSocketAddress (addr, m_defaultPort);
-    }
-  else if (Ipv6Address::IsMatchingType (m_defaultAddress))
-    {
-      Ipv6Address addr = Ipv6Address::ConvertFrom (m_defaultAddress);
-      address = Inet6SocketAddress (addr, m_defaultPort);
-    }
-  else
+  RudpHeader rudpHeader;
+  rudpHeader.SetMessageNumber (messageNumber);
+  rudpHeader.SetPositionFlag (position);
+  rudpHeader.SetInorderFlag (m_inOrderDelivery);
+  if (SendDataPacket (p, rudpHeader, address) < 0)
     {
-      NS_ASSERT_MSG (false, "unexpected address type");
+      if (!accepted)
+        {
+          return -1;
+        }
+      // The application was told the message was sent, leave it to
+      // retransmission
+      NS_LOG_LOGIC ("Message not sent, error " << m_errno);
     }
-
+  AddToTxBuffer (p, rudpHeader, address, expiry);
+  NotifyDataSent (p->GetSize ());
   return 0;
 }
 
 void
-RudpSocketImpl::BindToNetDevice (Ptr<NetDevice> netdevice)
+RudpSocketImpl::SendPending (void)
 {
-  NS_LOG_FUNCTION (netdevice);
-
-  Socket::BindToNetDevice (netdevice); // Includes sanity check
-  if (m_endPoint == 0)
+  NS_LOG_FUNCTION (this);
+  while (!m_sendQueue.empty ())
     {
-      if (Bind () == -1)
+      PendingMessage message = m_sendQueue.front ();
+      if (!message.m_expiry.IsZero () && message.m_expiry <= Simulator::Now ())
         {
-          NS_ASSERT (m_endPoint == 0);
-          return;
+          // Late, whatever the window: never send it
+          NS_LOG_LOGIC ("Message " << message.m_messageNumber << " expired before it was sent");
+          if (message.m_position & RudpHeader::FIRST)
+            {
+              DiscardQueuedFragments (message.m_messageNumber);
+            }
+          else
+            {
+              // Its first fragments went out, the receiver holds them
+              DropMessage (message.m_messageNumber, message.m_destination);
+            }
+          continue;
         }
-      NS_ASSERT (m_endPoint != 0);
-    }
-  m_endPoint->BindToNetDevice (netdevice);
-
-  if (m_endPoint6 == 0)
-    {
-      if (Bind6 () == -1)
+      if (!IsSendWindowOpen (message.m_packet->GetSize ()) || !IsPacingOpen ())
         {
-          NS_ASSERT (m_endPoint6 == 0);
-          return;
+          break;
         }
-      NS_ASSERT (m_endPoint6 != 0);
+      m_sendQueue.pop_front ();
+      m_sendQueueBytes -= message.m_packet->GetSize ();
+      SendFragment (message.m_packet, message.m_messageNumber, message.m_position,
+                    message.m_expiry, message.m_destination, true);
     }
-  m_endPoint6->BindToNetDevice (netdevice);
-
-  return;
 }
 
-void 
-RudpSocketImpl::ForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port,
-                          Ptr<Ipv4Interface> incomingInterface)
+void
+RudpSocketImpl::AddToBundle (Ptr<Packet> p, uint32_t messageNumber, Time expiry, const Address &address)
 {
-  NS_LOG_FUNCTION (this << packet << header << port);
-
-  if (m_shutdownRecv)
+  NS_LOG_FUNCTION (this << p << messageNumber << expiry << address);
+  if (m_bundle != 0
+      && (address != m_bundleDestination
+          || m_bundle->GetSize () + RudpChunkHeader::SIZE + p->GetSize ()
+          > std::min (m_maxBundleSize, GetMaxPayloadSize ())))
     {
-      return;
+      FlushBundle ();
     }
 
-  // Should check via getsockopt ()..
-  if (IsRecvPktInfo ())
+  RudpChunkHeader chunk;
+  chunk.SetLength (p->GetSize ());
+  chunk.SetMessageNumber (messageNumber);
+  Ptr<Packet> message = p->Copy ();
+  message->AddHeader (chunk);
+  if (m_bundle == 0)
     {
-      Ipv4PacketInfoTag tag;
-      packet->RemovePacketTag (tag);
-      tag.SetRecvIf (incomingInterface->GetDevice ()->GetIfIndex ());
-      packet->AddPacketTag (tag);
+      // The bundle keeps the tags of its first message
+      m_bundle = message;
+      m_bundleDestination = address;
+      m_bundleExpiry = expiry;
+      m_bundleMessageBytes = 0;
     }
-
-  //Check only version 4 options
-  if (IsIpRecvTos ())
+  else
     {
-      SocketIpTosTag ipTosTag;
-      ipTosTag.SetTos (header.GetTos ());
-      packet->AddPacketTag (ipTosTag);
+      m_bundle->AddAtEnd (message);
+      // The bundle is given up on only once all its messages are
+      if (!m_bundleExpiry.IsZero ())
+        {
+          m_bundleExpiry = expiry.IsZero () ? expiry : std::max (m_bundleExpiry, expiry);
+        }
     }
+  m_bundleMessageNumber = messageNumber;
+  m_bundleMessageBytes += p->GetSize ();
 
-  if (IsIpRecvTtl ())
+  if (!m_bundleEvent.IsRunning ())
     {
-      SocketIpTtlTag ipTtlTag;
-      ipTtlTag.SetTtl (header.GetTtl ());
-      packet->AddPacketTag (ipTtlTag);
+      m_bundleEvent = Simulator::Schedule (m_bundleDelay, &RudpSocketImpl::FlushBundle, this);
     }
+}
 
-  if ((m_rxAvailable + packet->GetSize ()) <= m_rcvBufSize)
+void
+RudpSocketImpl::FlushBundle (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_bundleEvent.Cancel ();
+  if (m_bundle == 0)
     {
-      Address address = InetSocketAddress (header.GetSource (), port);
-      SocketAddressTag tag;
-      tag.SetAddress (address);
-      packet->AddPacketTag (tag);
-      m_deliveryQueue.push (packet);
-      m_rxAvailable += packet->GetSize ();
-      NotifyDataRecv ();
+      return;
     }
-  else
+  Ptr<Packet> bundle = m_bundle;
+  m_bundle = 0;
+
+  RudpHeader rudpHeader;
+  rudpHeader.SetBundleFlag (true);
+  rudpHeader.SetPositionFlag (RudpHeader::SOLO);
+  rudpHeader.SetMessageNumber (m_bundleMessageNumber);
+  rudpHeader.SetInorderFlag (m_inOrderDelivery);
+  if (SendDataPacket (bundle, rudpHeader, m_bundleDestination) < 0)
     {
-      // In general, this case should not occur unless the
-      // receiving application reads data from this socket slowly
-      // in comparison to the arrival rate
+      // The messages were accepted already, leave them to retransmission
+      NS_LOG_LOGIC ("Bundle not sent, error " << m_errno);
+    }
+  AddToTxBuffer (bundle, rudpHeader, m_bundleDestination, m_bundleExpiry);
+  // Only now are the bundled messages sent
+  NotifyDataSent (m_bundleMessageBytes);
+}
+
+uint32_t
+RudpSocketImpl::GetSendWindowSpace (void) const
+{
+  uint32_t pending = m_bytesInFlight + (m_bundle != 0 ? m_bundle->GetSize () : 0);
+  uint32_t window = GetSendWindow ();
+  return pending < window ? window - pending : 0;
+}
+
+uint32_t
+RudpSocketImpl::GetSendWindow (void) const
+{
+  return std::min (m_peerWindow, m_congestion->GetCongestionWindow ());
+}
+
+void
+RudpSocketImpl::PacketLost (uint32_t seq)
+{
+  NS_LOG_FUNCTION (this << seq);
+  if (FindTxItem (seq) == 0 || RudpHeader::SequenceLessThan (seq, m_recoverySeq))
+    {
+      return;
+    }
+  // Packets sent until now may be lost to the same congestion
+  m_recoverySeq = m_nextTxSeq;
+  m_congestion->CongestionEvent (m_bytesInFlight);
+}
+
+bool
+RudpSocketImpl::IsSendWindowOpen (uint32_t size) const
+{
+  // With nothing outstanding, a packet goes out anyway to probe a closed
+  // window: the receiver answers it with its current window
+  return size <= GetSendWindowSpace ()
+         || (m_bytesInFlight == 0 && m_bundle == 0);
+}
+
+bool
+RudpSocketImpl::UseCompactHeader (const Address &address) const
+{
+  if (!m_connected || m_peerConnectionId == 0)
+    {
+      return false;
+    }
+  if (Ipv4Address::IsMatchingType (m_defaultAddress))
+    {
+      if (address != InetSocketAddress (Ipv4Address::ConvertFrom (m_defaultAddress), m_defaultPort))
+        {
+          return false;
+        }
+    }
+  else if (Ipv6Address::IsMatchingType (m_defaultAddress))
+    {
+      if (address != Inet6SocketAddress (Ipv6Address::ConvertFrom (m_defaultAddress), m_defaultPort))
+        {
+          return false;
+        }
+    }
+  // The receiver expands truncated numbers against the ones it expects,
+  // keep what is in flight well within half the truncated ranges. With
+  // small messages, the message numbers outrun the sequence numbers.
+  if (RudpHeader::SequenceOffset (m_txFirstSeq, m_nextTxSeq)
+      >= static_cast<int32_t> (RudpHeader::COMPACT_SEQUENCE_MASK >> 2))
+    {
+      return false;
+    }
+  uint32_t oldestMessage = (m_txFirstSeq != m_nextTxSeq) ?
+    m_txRing[m_txFirstSeq & m_txRingMask].m_header.GetMessageNumber () : m_nextMessageNumber;
+  return ((m_nextMessageNumber - oldestMessage) & RudpHeader::MAX_MESSAGE_NUMBER)
+         < (RudpHeader::COMPACT_MESSAGE_MASK >> 2);
+}
+
+void
+RudpSocketImpl::AddToTxBuffer (Ptr<Packet> p, const RudpHeader &rudpHeader, const Address &address,
+                               Time expiry)
+{
+  NS_LOG_FUNCTION (this << p << rudpHeader.GetSequenceNumber ());
+  NS_ASSERT (rudpHeader.GetSequenceNumber () == m_nextTxSeq);
+  if (RudpHeader::SequenceOffset (m_txFirstSeq, m_nextTxSeq) >= static_cast<int32_t> (m_txRing.size ()))
+    {
+      GrowTxRing ();
+    }
+  // After an idle period, the deadline left from the last flight is stale
+  bool idle = (m_txFirstSeq == m_nextTxSeq);
+  TxItem &item = m_txRing[m_nextTxSeq & m_txRingMask];
+  item.m_packet = p;
+  item.m_header = rudpHeader;
+  item.m_destination = address;
+  item.m_sendTime = Simulator::Now ();
+  item.m_retxCount = 0;
+  item.m_expiry = expiry;
+  item.m_dropped = false;
+  m_bytesInFlight += p->GetSize ();
+
+  m_nextTxSeq = RudpHeader::IncrementSequence (m_nextTxSeq);
+  if (idle || !m_retxEvent.IsRunning ())
+    {
+      SetRetxTimer ();
+    }
+  SetProbeTimer ();
+  ArmTimer ();
+}
+
+RudpSocketImpl::TxItem *
+RudpSocketImpl::FindTxItem (uint32_t seq)
+{
+  if (RudpHeader::SequenceLessThan (seq, m_txFirstSeq)
+      || !RudpHeader::SequenceLessThan (seq, m_nextTxSeq))
+    {
+      return 0;
+    }
+  TxItem &item = m_txRing[seq & m_txRingMask];
+  return item.m_packet != 0 ? &item : 0;
+}
+
+void
+RudpSocketImpl::GrowTxRing (void)
+{
+  NS_LOG_FUNCTION (this << m_txRing.size ());
+  // The sequence space is a multiple of the ring size, slots keep
+  // their sequence number modulo the new size
+  std::vector<TxItem> ring (m_txRing.size () * 2);
+  uint32_t mask = ring.size () - 1;
+  for (uint32_t seq = m_txFirstSeq; seq != m_nextTxSeq; seq = RudpHeader::IncrementSequence (seq))
+    {
+      ring[seq & mask] = m_txRing[seq & m_txRingMask];
+    }
+  m_txRing.swap (ring);
+  m_txRingMask = mask;
+}
+
+void
+RudpSocketImpl::Retransmit (uint32_t seq)
+{
+  NS_LOG_FUNCTION (this << seq);
+  TxItem *slot = FindTxItem (seq);
+  if (slot == 0)
+    {
+      return;
+    }
+  TxItem &item = *slot;
+  if (item.m_dropped)
+    {
+      // The DROP was lost, it is resent once for all the fragments
+      DropMessage (item.m_header.GetMessageNumber (), item.m_destination);
+      return;
+    }
+  if (!item.m_expiry.IsZero () && item.m_expiry <= Simulator::Now ())
+    {
+      NS_LOG_LOGIC ("Message " << item.m_header.GetMessageNumber () << " expired, dropping it");
+      DropMessage (item.m_header.GetMessageNumber (), item.m_destination);
+      return;
+    }
+  if (SendPacket (item.m_packet, item.m_header, item.m_destination) < 0)
+    {
+      NS_LOG_LOGIC ("Retransmission of " << seq << " failed");
+      return;
+    }
+  m_congestion->PacketSent (item.m_packet->GetSize (), m_bytesInFlight);
+  item.m_sendTime = Simulator::Now ();
+  item.m_retxCount++;
+}
+
+Time
+RudpSocketImpl::GetRto (void) const
+{
+  Time rto = m_srtt.IsZero () ? m_initialRto : m_rto.Get ();
+  for (uint32_t i = 0; i < m_rtoBackoff && rto < m_maxRto; i++)
+    {
+      rto = rto * 2;
+    }
+  return std::min (rto, m_maxRto);
+}
+
+void
+RudpSocketImpl::SetRetxTimer (void)
+{
+  m_retxDeadline = Simulator::Now () + GetRto ();
+  ArmTimer ();
+}
+
+void
+RudpSocketImpl::SetProbeTimer (void)
+{
+  // One probe per flight, and none while RACK already waits to declare
+  // a loss or the RTO is backing off
+  if (!m_tailLossProbe || m_probeOutstanding || m_srtt.IsZero ()
+      || m_rtoBackoff > 0 || !m_rackDeadline.IsZero () || m_txFirstSeq == m_nextTxSeq)
+    {
+      m_probeDeadline = Time (0);
+      return;
+    }
+  Time pto = m_srtt * 2;
+  if (RudpHeader::IncrementSequence (m_txFirstSeq) == m_nextTxSeq)
+    {
+      // A single packet in flight is acknowledged by the delayed ACK timer
+      pto += m_ackDelay;
+    }
+  Time deadline = Simulator::Now () + pto;
+  m_probeDeadline = std::min (deadline, m_retxDeadline);
+}
+
+void
+RudpSocketImpl::SendProbe (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_probeOutstanding = true;
+  // New data draws an ACK as well as a retransmission does
+  uint32_t nextTxSeq = m_nextTxSeq;
+  SendPending ();
+  if (m_nextTxSeq == nextTxSeq)
+    {
+      uint32_t seq = m_nextTxSeq;
+      do
+        {
+          seq = RudpHeader::IncrementSequence (seq, RudpHeader::MAX_SEQUENCE_NUMBER);
+        }
+      while (m_txRing[seq & m_txRingMask].m_packet == 0 && seq != m_txFirstSeq);
+      NS_LOG_LOGIC ("Tail loss probe, packet " << seq);
+      Retransmit (seq);
+    }
+  // The probe is no congestion signal, the retransmission timeout restarts
+  SetRetxTimer ();
+}
+
+void
+RudpSocketImpl::ArmTimer (void)
+{
+  // One timer for the socket. ACKs only move the deadlines, the event is
+  // rescheduled when it fires early, or when a deadline moves before it
+  Time deadline = m_retxDeadline;
+  if (!m_rackDeadline.IsZero () && m_rackDeadline < deadline)
+    {
+      deadline = m_rackDeadline;
+    }
+  if (!m_probeDeadline.IsZero () && m_probeDeadline < deadline)
+    {
+      deadline = m_probeDeadline;
+    }
+  Time delay = std::max (deadline - Simulator::Now (), Time (0));
+  if (m_retxEvent.IsRunning () && Simulator::GetDelayLeft (m_retxEvent) <= delay)
+    {
+      return;
+    }
+  m_retxEvent.Cancel ();
+  m_retxEvent = Simulator::Schedule (delay, &RudpSocketImpl::TimerExpired, this);
+}
+
+void
+RudpSocketImpl::TimerExpired (void)
+{
+  if (m_txFirstSeq == m_nextTxSeq)
+    {
+      // Nothing in flight, the timer stays off until the next packet
+      m_rackDeadline = Time (0);
+      m_probeDeadline = Time (0);
+      return;
+    }
+  Time now = Simulator::Now ();
+  if (!m_rackDeadline.IsZero () && now >= m_rackDeadline)
+    {
+      m_rackDeadline = Time (0);
+      DetectLosses ();
+    }
+  if (!m_probeDeadline.IsZero () && now >= m_probeDeadline)
+    {
+      m_probeDeadline = Time (0);
+      if (now < m_retxDeadline)
+        {
+          SendProbe ();
+        }
+    }
+  if (now >= m_retxDeadline)
+    {
+      RetxTimeout ();
+    }
+  ArmTimer ();
+}
+
+void
+RudpSocketImpl::RetxTimeout (void)
+{
+  NS_LOG_LOGIC ("Retransmission timeout, oldest packet " << m_txFirstSeq);
+  m_rtoBackoff++;
+  m_congestion->Timeout ();
+  // The timeout is the congestion event of everything in flight
+  m_recoverySeq = m_nextTxSeq;
+  m_probeDeadline = Time (0);
+  Retransmit (m_txFirstSeq);
+  m_retxDeadline = Simulator::Now () + GetRto ();
+}
+
+void
+RudpSocketImpl::UpdateRack (const TxItem &item)
+{
+  Time rtt = Simulator::Now () - item.m_sendTime;
+  if (item.m_retxCount > 0 && rtt < m_minRtt)
+    {
+      // Faster than the path allows: the original transmission arrived,
+      // not the one m_sendTime is the time of
+      return;
+    }
+  if (item.m_sendTime > m_rackSendTime)
+    {
+      m_rackSendTime = item.m_sendTime;
+      m_rackRtt = rtt;
+    }
+}
+
+Time
+RudpSocketImpl::GetReorderWindow (void) const
+{
+  Time window = m_minRtt * m_reorderWindowFactor;
+  return std::min (window, m_srtt);
+}
+
+void
+RudpSocketImpl::DetectLosses (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_rackSendTime.IsZero ())
+    {
+      return;
+    }
+  // A packet is lost once a packet sent after it was delivered, and it
+  // did not arrive within the reordering window. Duplicate counts would
+  // retransmit packets merely overtaken on other paths.
+  Time now = Simulator::Now ();
+  Time reorderWindow = GetReorderWindow ();
+  Time timeout (0);
+  for (uint32_t seq = m_txFirstSeq; seq != m_nextTxSeq; seq = RudpHeader::IncrementSequence (seq))
+    {
+      TxItem &item = m_txRing[seq & m_txRingMask];
+      if (item.m_packet == 0)
+        {
+          continue;
+        }
+      if (item.m_sendTime > m_rackSendTime)
+        {
+          if (item.m_retxCount == 0)
+            {
+              // First transmissions go out in sequence order, all the
+              // next ones were sent later too
+              break;
+            }
+          continue;
+        }
+      Time remaining = item.m_sendTime + m_rackRtt + reorderWindow - now;
+      if (remaining <= Time (0))
+        {
+          PacketLost (seq);
+          Retransmit (seq);
+        }
+      else if (remaining > timeout)
+        {
+          timeout = remaining;
+        }
+    }
+  m_rackDeadline = timeout.IsZero () ? Time (0) : now + timeout;
+}
+
+uint32_t
+RudpSocketImpl::GetTxAvailable (void) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  // The send buffer holds the messages waiting for the peer's window and
+  // the packets sent but not yet acknowledged
+  uint32_t buffered = m_bytesInFlight + m_sendQueueBytes + (m_bundle != 0 ? m_bundle->GetSize () : 0);
+  return buffered < m_sndBufSize ? m_sndBufSize - buffered : 0;
+}
+
+int 
+RudpSocketImpl::SendTo (Ptr<Packet> p, uint32_t flags, const Address &address)
+{
+  NS_LOG_FUNCTION (this << p << flags << address);
+  if (InetSocketAddress::IsMatchingType (address))
+    {
+      if (IsManualIpTos ())
+        {
+          SocketIpTosTag ipTosTag;
+          ipTosTag.SetTos (GetIpTos ());
+          p->AddPacketTag (ipTosTag);
+        }
+
+      InetSocketAddress transport = InetSocketAddress::ConvertFrom (address);
+      Ipv4Address ipv4 = transport.GetIpv4 ();
+      uint16_t port = transport.GetPort ();
+      return DoSendTo (p, ipv4, port);
+    }
+  else if (Inet6SocketAddress::IsMatchingType (address))
+    {
+      if (IsManualIpv6Tclass ())
+        {
+          SocketIpv6TclassTag ipTclassTag;
+          ipTclassTag.SetTclass (GetIpv6Tclass ());
+          p->AddPacketTag (ipTclassTag);
+        }
+
+      Inet6SocketAddress transport = Inet6SocketAddress::ConvertFrom (address);
+      Ipv6Address ipv6 = transport.GetIpv6 ();
+      uint16_t port = transport.GetPort ();
+      return DoSendTo (p, ipv6, port);
+    }
+  return -1;
+}
+
+uint32_t
+RudpSocketImpl::GetRxAvailable (void) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  // We separately maintain this state to avoid walking the queue 
+  // every time this might be called
+  return m_rxAvailable;
+}
+
+Ptr<Packet>
+RudpSocketImpl::Recv (uint32_t maxSize, uint32_t flags)
+{
+  NS_LOG_FUNCTION (this << maxSize << flags);
+  if (m_deliveryQueue.empty () )
+    {
+      m_errno = ERROR_AGAIN;
+      return 0;
+    }
+  Ptr<Packet> p = m_deliveryQueue.front ();
+  if (p->GetSize () <= maxSize) 
+    {
+      m_deliveryQueue.pop ();
+      m_rxAvailable -= p->GetSize ();
+      UpdateWindow ();
+    }
+  else
+    {
+      p = 0; 
+    }
+  return p;
+}
+
+void
+RudpSocketImpl::UpdateWindow (void)
+{
+  // The sender stops once our window closes, tell it as soon as the
+  // application has made enough room
+  if (!m_windowPeer.IsInvalid () && (m_endPoint != 0 || m_endPoint6 != 0)
+      && GetRxWindow () >= m_advertisedWindow + m_rcvBufSize / 2)
+    {
+      SendAck (m_windowPeer);
+    }
+}
+
+Ptr<Packet>
+RudpSocketImpl::RecvFrom (uint32_t maxSize, uint32_t flags, 
+                         Address &fromAddress)
+{
+  NS_LOG_FUNCTION (this << maxSize << flags);
+  Ptr<Packet> packet = Recv (maxSize, flags);
+  if (packet != 0)
+    {
+      SocketAddressTag tag;
+      bool found;
+      found = packet->PeekPacketTag (tag);
+      NS_ASSERT (found);
+      fromAddress = tag.GetAddress ();
+    }
+  return packet;
+}
+
+uint32_t
+RudpSocketImpl::RecvMany (std::vector<Ptr<Packet> > &packets, std::vector<Address> &fromAddresses,
+                          uint32_t maxPackets, uint32_t flags)
+{
+  NS_LOG_FUNCTION (this << maxPackets << flags);
+  uint32_t count = 0;
+  while (count < maxPackets && !m_deliveryQueue.empty ())
+    {
+      Ptr<Packet> p = m_deliveryQueue.front ();
+      m_deliveryQueue.pop ();
+      m_rxAvailable -= p->GetSize ();
+      SocketAddressTag tag;
+      bool found;
+      found = p->PeekPacketTag (tag);
+      NS_ASSERT (found);
+      packets.push_back (p);
+      fromAddresses.push_back (tag.GetAddress ());
+      count++;
+    }
+  if (count == 0)
+    {
+      m_errno = ERROR_AGAIN;
+      return 0;
+    }
+  // One window update for the whole batch
+  UpdateWindow ();
+  return count;
+}
+
+int
+RudpSocketImpl::SendMany (const std::vector<Ptr<Packet> > &packets, uint32_t flags,
+                          const Address &address)
+{
+  NS_LOG_FUNCTION (this << packets.size () << flags << address);
+  if (InetSocketAddress::IsMatchingType (address))
+    {
+      InetSocketAddress transport = InetSocketAddress::ConvertFrom (address);
+      return DoSendManyTo (packets, transport.GetIpv4 (), transport.GetPort ());
+    }
+  else if (Inet6SocketAddress::IsMatchingType (address))
+    {
+      Inet6SocketAddress transport = Inet6SocketAddress::ConvertFrom (address);
+      return DoSendManyTo (packets, transport.GetIpv6 (), transport.GetPort ());
+    }
+  m_errno = ERROR_AFNOSUPPORT;
+  return -1;
+}
+
+int
+RudpSocketImpl::DoSendManyTo (const std::vector<Ptr<Packet> > &packets, Ipv4Address dest, uint16_t port)
+{
+  NS_LOG_FUNCTION (this << packets.size () << dest << port);
+  if (m_endPoint == 0)
+    {
+      if (Bind () == -1)
+        {
+          NS_ASSERT (m_endPoint == 0);
+          return -1;
+        }
+      NS_ASSERT (m_endPoint != 0);
+    }
+  if (m_shutdownSend)
+    {
+      m_errno = ERROR_SHUTDOWN;
+      return -1;
+    }
+
+  // The tags are the same for the whole batch, build them once
+  bool setTos = IsManualIpTos ();
+  SocketIpTosTag ipTosTag;
+  ipTosTag.SetTos (GetIpTos ());
+  bool setTtl = IsManualIpTtl () && GetIpTtl () != 0 && !dest.IsMulticast () && !dest.IsBroadcast ();
+  SocketIpTtlTag ipTtlTag;
+  ipTtlTag.SetTtl (GetIpTtl ());
+  SocketSetDontFragmentTag dontFragmentTag;
+  if (m_mtuDiscover)
+    {
+      dontFragmentTag.Enable ();
+    }
+  else
+    {
+      dontFragmentTag.Disable ();
+    }
+  InetSocketAddress destination (dest, port);
+
+  int accepted = 0;
+  for (std::vector<Ptr<Packet> >::const_iterator it = packets.begin (); it != packets.end (); ++it)
+    {
+      Ptr<Packet> p = *it;
+      if (p->GetSize () > m_sndBufSize)
+        {
+          m_errno = ERROR_MSGSIZE;
+          break;
+        }
+      if (p->GetSize () > GetTxAvailable ())
+        {
+          NS_LOG_LOGIC ("Send buffer full after " << accepted << " messages");
+          m_errno = ERROR_AGAIN;
+          break;
+        }
+      if (setTos)
+        {
+          p->AddPacketTag (ipTosTag);
+        }
+      if (setTtl)
+        {
+          p->AddPacketTag (ipTtlTag);
+        }
+      SocketSetDontFragmentTag tag;
+      if (!p->PeekPacketTag (tag))
+        {
+          p->AddPacketTag (dontFragmentTag);
+        }
+      if (QueueMessage (p, destination) < 0)
+        {
+          break;
+        }
+      accepted++;
+    }
+  if (accepted == 0)
+    {
+      return -1;
+    }
+  NotifySend (GetTxAvailable ());
+  return accepted;
+}
+
+int
+RudpSocketImpl::DoSendManyTo (const std::vector<Ptr<Packet> > &packets, Ipv6Address dest, uint16_t port)
+{
+  NS_LOG_FUNCTION (this << packets.size () << dest << port);
+  if (dest.IsIpv4MappedAddress ())
+    {
+      return DoSendManyTo (packets, dest.GetIpv4MappedAddress (), port);
+    }
+  if (m_endPoint6 == 0)
+    {
+      if (Bind6 () == -1)
+        {
+          NS_ASSERT (m_endPoint6 == 0);
+          return -1;
+        }
+      NS_ASSERT (m_endPoint6 != 0);
+    }
+  if (m_shutdownSend)
+    {
+      m_errno = ERROR_SHUTDOWN;
+      return -1;
+    }
+
+  // The tags are the same for the whole batch, build them once
+  bool setTclass = IsManualIpv6Tclass ();
+  SocketIpv6TclassTag ipTclassTag;
+  ipTclassTag.SetTclass (GetIpv6Tclass ());
+  bool setHopLimit = IsManualIpv6HopLimit () && GetIpv6HopLimit () != 0 && !dest.IsMulticast ();
+  SocketIpv6HopLimitTag ipHopLimitTag;
+  ipHopLimitTag.SetHopLimit (GetIpv6HopLimit ());
+  Inet6SocketAddress destination (dest, port);
+
+  int accepted = 0;
+  for (std::vector<Ptr<Packet> >::const_iterator it = packets.begin (); it != packets.end (); ++it)
+    {
+      Ptr<Packet> p = *it;
+      if (p->GetSize () > m_sndBufSize)
+        {
+          m_errno = ERROR_MSGSIZE;
+          break;
+        }
+      if (p->GetSize () > GetTxAvailable ())
+        {
+          NS_LOG_LOGIC ("Send buffer full after " << accepted << " messages");
+          m_errno = ERROR_AGAIN;
+          break;
+        }
+      if (setTclass)
+        {
+          p->AddPacketTag (ipTclassTag);
+        }
+      if (setHopLimit)
+        {
+          p->AddPacketTag (ipHopLimitTag);
+        }
+      if (QueueMessage (p, destination) < 0)
+        {
+          break;
+        }
+      accepted++;
+    }
+  if (accepted == 0)
+    {
+      return -1;
+    }
+  NotifySend (GetTxAvailable ());
+  return accepted;
+}
+
+int
+RudpSocketImpl::GetSockName (Address &address) const
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (m_endPoint != 0)
+    {
+      address = InetSocketAddress (m_endPoint->GetLocalAddress (), m_endPoint->GetLocalPort ());
+    }
+  else if (m_endPoint6 != 0)
+    {
+      address = Inet6SocketAddress (m_endPoint6->GetLocalAddress (), m_endPoint6->GetLocalPort ());
+    }
+  else
+    { // It is possible to call this method on a socket without a name
+      // in which case, behavior is unspecified
+      // Should this return an InetSocketAddress or an Inet6SocketAddress?
+      address = InetSocketAddress (Ipv4Address::GetZero (), 0);
+    }
+  return 0;
+}
+
+int
+RudpSocketImpl::GetPeerName (Address &address) const
+{
+  NS_LOG_FUNCTION (this << address);
+
+  if (!m_connected)
+    {
+      m_errno = ERROR_NOTCONN;
+      return -1;
+    }
+
+  if (Ipv4Address::IsMatchingType (m_defaultAddress))
+    {
+      Ipv4Address addr = Ipv4Address::ConvertFrom (m_defaultAddress);
+      address = InetSocketAddress (addr, m_defaultPort);
+    }
+  else if (Ipv6Address::IsMatchingType (m_defaultAddress))
+    {
+      Ipv6Address addr = Ipv6Address::ConvertFrom (m_defaultAddress);
+      address = Inet6SocketAddress (addr, m_defaultPort);
+    }
+  else
+    {
+      NS_ASSERT_MSG (false, "unexpected address type");
+    }
+
+  return 0;
+}
+
+void
+RudpSocketImpl::BindToNetDevice (Ptr<NetDevice> netdevice)
+{
+  NS_LOG_FUNCTION (netdevice);
+
+  Socket::BindToNetDevice (netdevice); // Includes sanity check
+  // The cached routes may leave through another device
+  FlushRouteCache ();
+  if (m_endPoint == 0)
+    {
+      if (Bind () == -1)
+        {
+          NS_ASSERT (m_endPoint == 0);
+          return;
+        }
+      NS_ASSERT (m_endPoint != 0);
+    }
+  m_endPoint->BindToNetDevice (netdevice);
+
+  if (m_endPoint6 == 0)
+    {
+      if (Bind6 () == -1)
+        {
+          NS_ASSERT (m_endPoint6 == 0);
+          return;
+        }
+      NS_ASSERT (m_endPoint6 != 0);
+    }
+  m_endPoint6->BindToNetDevice (netdevice);
+
+  return;
+}
+
+void 
+RudpSocketImpl::ForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port,
+                          Ptr<Ipv4Interface> incomingInterface)
+{
+  NS_LOG_FUNCTION (this << packet << header << port);
+
+  if (m_shutdownRecv)
+    {
+      return;
+    }
+
+  // Should check via getsockopt ()..
+  if (IsRecvPktInfo ())
+    {
+      Ipv4PacketInfoTag tag;
+      packet->RemovePacketTag (tag);
+      tag.SetRecvIf (incomingInterface->GetDevice ()->GetIfIndex ());
+      packet->AddPacketTag (tag);
+    }
+
+  //Check only version 4 options
+  if (IsIpRecvTos ())
+    {
+      SocketIpTosTag ipTosTag;
+      ipTosTag.SetTos (header.GetTos ());
+      packet->AddPacketTag (ipTosTag);
+    }
+
+  if (IsIpRecvTtl ())
+    {
+      SocketIpTtlTag ipTtlTag;
+      ipTtlTag.SetTtl (header.GetTtl ());
+      packet->AddPacketTag (ipTtlTag);
+    }
+
+  DoForwardUp (packet, InetSocketAddress (header.GetSource (), port));
+}
+
+void 
+RudpSocketImpl::ForwardUp6 (Ptr<Packet> packet, Ipv6Header header, uint16_t port, Ptr<Ipv6Interface> incomingInterface)
+{
+  NS_LOG_FUNCTION (this << packet << header.GetSourceAddress () << port);
+
+  if (m_shutdownRecv)
+    {
+      return;
+    }
+
+  // Should check via getsockopt ()..
+  if (IsRecvPktInfo ())
+    {
+      Ipv6PacketInfoTag tag;
+      packet->RemovePacketTag (tag);
+      tag.SetRecvIf (incomingInterface->GetDevice ()->GetIfIndex ());
+      packet->AddPacketTag (tag);
+    }
+
+  //Check only version 6 options
+  if (IsIpv6RecvTclass ())
+    {
+      SocketIpv6TclassTag ipTclassTag;
+      ipTclassTag.SetTclass (header.GetTrafficClass ());
+      packet->AddPacketTag (ipTclassTag);
+    }
+
+  if (IsIpv6RecvHopLimit ())
+    {
+      SocketIpv6HopLimitTag ipHopLimitTag;
+      ipHopLimitTag.SetHopLimit (header.GetHopLimit ());
+      packet->AddPacketTag (ipHopLimitTag);
+    }
+
+  DoForwardUp (packet, Inet6SocketAddress (header.GetSourceAddress (), port));
+}
+
+void
+RudpSocketImpl::DoForwardUp (Ptr<Packet> packet, const Address &fromAddress)
+{
+  NS_LOG_FUNCTION (this << packet << fromAddress);
+
+  RudpHeader rudpHeader;
+  packet->RemoveHeader (rudpHeader);
+
+  // Sequence numbers, ACKs and NAKs only make sense in the sequence
+  // spaces shared with the peer. Control packets never make a peer.
+  if (rudpHeader.GetControlFlag () ? (m_peer.IsInvalid () || fromAddress != m_peer) : !MatchPeer (fromAddress))
+    {
+      NS_LOG_LOGIC ("Packet from " << fromAddress << ", not the peer " << m_peer << ", dropped");
+      m_dropTrace (packet);
+      return;
+    }
+
+  if (rudpHeader.GetControlFlag ())
+    {
+      ProcessControl (packet, rudpHeader, fromAddress);
+      return;
+    }
+
+  if (rudpHeader.IsCompact ())
+    {
+      rudpHeader.SetSequenceNumber (RudpHeader::ExpandTruncated (rudpHeader.GetSequenceNumber (), m_rxNextSeq,
+                                                                 RudpHeader::COMPACT_SEQUENCE_MASK,
+                                                                 RudpHeader::MAX_SEQUENCE_NUMBER));
+      rudpHeader.SetMessageNumber (RudpHeader::ExpandTruncated (rudpHeader.GetMessageNumber (), m_rxMessageNumber,
+                                                                RudpHeader::COMPACT_MESSAGE_MASK,
+                                                                RudpHeader::MAX_MESSAGE_NUMBER));
+    }
+  else if (m_rxConnectionId == 0)
+    {
+      // Hand out a connection ID so that the peer can switch to compact
+      // headers once it is connected to us
+      uint16_t localPort = (m_endPoint != 0) ? m_endPoint->GetLocalPort () : m_endPoint6->GetLocalPort ();
+      uint16_t peerPort = InetSocketAddress::IsMatchingType (fromAddress) ?
+        InetSocketAddress::ConvertFrom (fromAddress).GetPort () :
+        Inet6SocketAddress::ConvertFrom (fromAddress).GetPort ();
+      m_rxConnectionId = m_rudp->AllocateConnectionId (localPort, peerPort);
+      m_rxConnectionPeer = fromAddress;
+    }
+
+  uint32_t seq = rudpHeader.GetSequenceNumber ();
+  if (IsDuplicate (seq))
+    {
+      // Our previous acknowledgement may have been lost
+      NS_LOG_LOGIC ("Duplicate sequence number " << seq);
+      UpdateTsRecent (rudpHeader, true);
+      SendAck (fromAddress);
+      return;
+    }
+
+  // Incomplete and reordered messages are acknowledged, they cannot be
+  // dropped to make room. They only drain once the packet at the
+  // cumulative ACK arrives, it is let in even if the buffer is full.
+  if ((m_rxAvailable + m_reassemblyBytes + m_reorderBytes + packet->GetSize ()) <= m_rcvBufSize
+      || (seq == m_rxNextSeq && m_reassemblyBytes + m_reorderBytes > 0))
+    {
+      // Out of order arrivals, and the ones filling a hole, change the
+      // SACK ranges and are acknowledged right away
+      bool outOfOrder = (seq != m_rxNextSeq) || !m_rxReceived.empty ();
+      UpdateTsRecent (rudpHeader, outOfOrder);
+      RecordReceived (seq);
+      if (RudpHeader::SequenceLessThan (m_rxHighSeq, seq))
+        {
+          // Report the gap right away instead of letting the sender
+          // wait for SACKs to pile up
+          SendNak (m_rxHighSeq, RudpHeader::IncrementSequence (seq, RudpHeader::MAX_SEQUENCE_NUMBER),
+                   fromAddress);
+        }
+      if (!RudpHeader::SequenceLessThan (seq, m_rxHighSeq))
+        {
+          m_rxHighSeq = RudpHeader::IncrementSequence (seq);
+          m_rxMessageNumber = rudpHeader.GetMessageNumber ();
+        }
+      if (outOfOrder)
+        {
+          SendAck (fromAddress);
+        }
+      else
+        {
+          ScheduleAck (fromAddress);
+        }
+
+      if (rudpHeader.GetBundleFlag ())
+        {
+          DeliverBundle (packet, rudpHeader, fromAddress);
+        }
+      else if (rudpHeader.GetPositionFlag () == RudpHeader::SOLO)
+        {
+          DeliverMessage (packet, fromAddress, seq, rudpHeader.GetInorderFlag ());
+        }
+      else
+        {
+          Reassemble (packet, rudpHeader, fromAddress);
+        }
+      DeliverReordered ();
+    }
+  else
+    {
+      // In general, this case should not occur unless the
+      // receiving application reads data from this socket slowly
+      // in comparison to the arrival rate
       //
-      // drop and trace packet
+      // drop and trace packet, it is not acknowledged so the
+      // sender will retransmit it
       NS_LOG_WARN ("No receive buffer space available.  Drop.");
       m_dropTrace (packet);
+      // Advertise the closed window
+      SendAck (fromAddress);
+    }
+}
+
+void
+RudpSocketImpl::Deliver (Ptr<Packet> packet, const Address &fromAddress)
+{
+  NS_LOG_FUNCTION (this << packet << fromAddress);
+  SocketAddressTag tag;
+  tag.SetAddress (fromAddress);
+  packet->AddPacketTag (tag);
+  m_deliveryQueue.push (packet);
+  m_rxAvailable += packet->GetSize ();
+  NotifyDataRecv ();
+}
+
+void
+RudpSocketImpl::DeliverMessage (Ptr<Packet> packet, const Address &fromAddress, uint32_t lastSeq, bool inOrder)
+{
+  NS_LOG_FUNCTION (this << packet << fromAddress << lastSeq << inOrder);
+  if (!inOrder)
+    {
+      // Unordered messages are not held back by the missing ones
+      Deliver (packet, fromAddress);
+      return;
+    }
+  // Even when nothing is missing before it, an in-order message goes
+  // through the buffer, behind the in-order messages completed before
+  ReorderedMessage message;
+  message.m_packet = packet;
+  message.m_source = fromAddress;
+  m_reorderBuffer.insert (std::make_pair (lastSeq, message));
+  m_reorderBytes += packet->GetSize ();
+}
+
+void
+RudpSocketImpl::DeliverReordered (void)
+{
+  while (!m_reorderBuffer.empty ()
+         && RudpHeader::SequenceLessThan (m_reorderBuffer.begin ()->first, m_rxNextSeq))
+    {
+      ReorderedMessage message = m_reorderBuffer.begin ()->second;
+      m_reorderBuffer.erase (m_reorderBuffer.begin ());
+      m_reorderBytes -= message.m_packet->GetSize ();
+      Deliver (message.m_packet, message.m_source);
+    }
+}
+
+void
+RudpSocketImpl::DeliverBundle (Ptr<Packet> packet, const RudpHeader &rudpHeader, const Address &fromAddress)
+{
+  NS_LOG_FUNCTION (this << packet << fromAddress);
+  while (packet->GetSize () >= RudpChunkHeader::SIZE)
+    {
+      RudpChunkHeader chunk;
+      packet->RemoveHeader (chunk);
+      if (chunk.GetLength () > packet->GetSize ())
+        {
+          NS_LOG_WARN ("Truncated chunk in bundle, dropping the rest");
+          m_dropTrace (packet);
+          return;
+        }
+      // Fragments keep the packet tags of the bundle
+      DeliverMessage (packet->CreateFragment (0, chunk.GetLength ()), fromAddress,
+                      rudpHeader.GetSequenceNumber (), rudpHeader.GetInorderFlag ());
+      packet->RemoveAtStart (chunk.GetLength ());
+    }
+}
+
+void
+RudpSocketImpl::Reassemble (Ptr<Packet> packet, const RudpHeader &rudpHeader, const Address &fromAddress)
+{
+  NS_LOG_FUNCTION (this << packet << rudpHeader.GetMessageNumber ());
+  uint32_t messageNumber = rudpHeader.GetMessageNumber ();
+  uint32_t seq = rudpHeader.GetSequenceNumber ();
+  std::map<uint32_t, uint32_t>::iterator found = m_reassembly.find (messageNumber);
+  if (found == m_reassembly.end ())
+    {
+      if (m_freeReassemblies.empty ())
+        {
+          m_freeReassemblies.push_back (m_reassemblies.size ());
+          m_reassemblies.push_back (Reassembly ());
+        }
+      found = m_reassembly.insert (std::make_pair (messageNumber, m_freeReassemblies.back ())).first;
+      m_freeReassemblies.pop_back ();
+    }
+  Reassembly &reassembly = m_reassemblies[found->second];
+  if (rudpHeader.GetPositionFlag () == RudpHeader::FIRST)
+    {
+      reassembly.m_firstSeq = seq;
+      reassembly.m_hasFirst = true;
+      reassembly.m_tags = packet->CreateFragment (0, 0);
+    }
+  else if (rudpHeader.GetPositionFlag () == RudpHeader::LAST)
+    {
+      reassembly.m_lastSeq = seq;
+      reassembly.m_hasLast = true;
+    }
+
+  Fragment fragment;
+  fragment.m_seq = seq;
+  fragment.m_size = packet->GetSize ();
+  fragment.m_slot = StoreFragment (packet);
+  std::vector<Fragment>::iterator pos = reassembly.m_fragments.end ();
+  while (pos != reassembly.m_fragments.begin ()
+         && RudpHeader::SequenceLessThan (seq, (pos - 1)->m_seq))
+    {
+      --pos;
+    }
+  reassembly.m_fragments.insert (pos, fragment);
+  reassembly.m_size += fragment.m_size;
+  m_reassemblyBytes += fragment.m_size;
+
+  // The fragments of a message have consecutive sequence numbers
+  if (!reassembly.m_hasFirst || !reassembly.m_hasLast
+      || reassembly.m_fragments.size ()
+      != static_cast<uint32_t> (RudpHeader::SequenceOffset (reassembly.m_firstSeq, reassembly.m_lastSeq)) + 1)
+    {
+      return;
+    }
+
+  // Gather the slots into one buffer, the message keeps the tags of its
+  // first fragment
+  std::vector<uint8_t> &scratch = m_reassemblyScratch;
+  if (scratch.size () < reassembly.m_size)
+    {
+      scratch.resize (reassembly.m_size);
+    }
+  uint32_t offset = 0;
+  for (std::vector<Fragment>::const_iterator it = reassembly.m_fragments.begin ();
+       it != reassembly.m_fragments.end (); ++it)
+    {
+      uint32_t left = it->m_size;
+      for (uint32_t slot = it->m_slot; left > 0; slot = m_fragmentSlotNext[slot])
+        {
+          uint32_t length = std::min (left, FRAGMENT_SLOT_SIZE);
+          std::memcpy (&scratch[offset], &m_fragmentSlots[slot * FRAGMENT_SLOT_SIZE], length);
+          offset += length;
+          left -= length;
+        }
+    }
+  Ptr<Packet> message = reassembly.m_tags;
+  message->AddAtEnd (Create<Packet> (&scratch[0], reassembly.m_size));
+  uint32_t lastSeq = reassembly.m_lastSeq;
+  ReleaseReassembly (messageNumber);
+  DeliverMessage (message, fromAddress, lastSeq, rudpHeader.GetInorderFlag ());
+}
+
+uint32_t
+RudpSocketImpl::StoreFragment (Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << packet);
+  // Copy the payload a slot at a time, from a copy sharing the buffer
+  Ptr<Packet> payload = packet->Copy ();
+  uint32_t size = payload->GetSize ();
+  uint32_t first = NO_FRAGMENT_SLOT;
+  uint32_t *link = &first;
+  for (uint32_t offset = 0; offset < size; offset += FRAGMENT_SLOT_SIZE)
+    {
+      if (m_freeFragmentSlot == NO_FRAGMENT_SLOT)
+        {
+          // The pool only grows, the receive buffer bounds what it holds
+          m_freeFragmentSlot = m_fragmentSlotNext.size ();
+          m_fragmentSlotNext.push_back (NO_FRAGMENT_SLOT);
+          m_fragmentSlots.resize (m_fragmentSlots.size () + FRAGMENT_SLOT_SIZE);
+        }
+      uint32_t slot = m_freeFragmentSlot;
+      m_freeFragmentSlot = m_fragmentSlotNext[slot];
+      uint32_t length = std::min (size - offset, FRAGMENT_SLOT_SIZE);
+      payload->CopyData (&m_fragmentSlots[slot * FRAGMENT_SLOT_SIZE], length);
+      payload->RemoveAtStart (length);
+      m_fragmentSlotNext[slot] = NO_FRAGMENT_SLOT;
+      *link = slot;
+      link = &m_fragmentSlotNext[slot];
+    }
+  return first;
+}
+
+void
+RudpSocketImpl::FreeFragmentSlots (uint32_t slot)
+{
+  while (slot != NO_FRAGMENT_SLOT)
+    {
+      uint32_t next = m_fragmentSlotNext[slot];
+      m_fragmentSlotNext[slot] = m_freeFragmentSlot;
+      m_freeFragmentSlot = slot;
+      slot = next;
+    }
+}
+
+void
+RudpSocketImpl::ReleaseReassembly (uint32_t messageNumber)
+{
+  NS_LOG_FUNCTION (this << messageNumber);
+  std::map<uint32_t, uint32_t>::iterator found = m_reassembly.find (messageNumber);
+  NS_ASSERT (found != m_reassembly.end ());
+  Reassembly &reassembly = m_reassemblies[found->second];
+  for (std::vector<Fragment>::const_iterator it = reassembly.m_fragments.begin ();
+       it != reassembly.m_fragments.end (); ++it)
+    {
+      FreeFragmentSlots (it->m_slot);
+    }
+  m_reassemblyBytes -= reassembly.m_size;
+  reassembly.m_fragments.clear ();
+  reassembly.m_tags = 0;
+  reassembly.m_size = 0;
+  reassembly.m_hasFirst = false;
+  reassembly.m_hasLast = false;
+  m_freeReassemblies.push_back (found->second);
+  m_reassembly.erase (found);
+}
+
+DataRate
+RudpSocketImpl::GetPacingRate (void) const
+{
+  DataRate rate = m_congestion->GetPacingRate ();
+  Time rtt = m_lastRtt.Get ();
+  if (rate.GetBitRate () > 0 || rtt.IsZero ())
+    {
+      return rate;
+    }
+  return DataRate (static_cast<uint64_t> (GetSendWindow () * 8.0 / rtt.GetSeconds ()));
+}
+
+bool
+RudpSocketImpl::IsPacing (void) const
+{
+  // Rate-based controllers, like DAIMD once out of slow start, respond to
+  // congestion through their rate only
+  return m_pacing || m_congestion->GetPacingRate ().GetBitRate () > 0;
+}
+
+bool
+RudpSocketImpl::IsPacingOpen (void)
+{
+  if (!IsPacing () || m_paceNextSend <= Simulator::Now ())
+    {
+      return true;
+    }
+  if (!m_paceEvent.IsRunning ())
+    {
+      m_paceEvent = Simulator::Schedule (m_paceNextSend - Simulator::Now (),
+                                         &RudpSocketImpl::SendPending, this);
+    }
+  return false;
+}
+
+void
+RudpSocketImpl::PaceSent (uint32_t size)
+{
+  if (!IsPacing ())
+    {
+      return;
+    }
+  m_paceBurstBytes += size;
+  if (m_paceBurstBytes < m_pacingBurst)
+    {
+      return;
+    }
+  // The burst is over, the next one waits until the rate has caught up
+  DataRate rate = GetPacingRate ();
+  if (rate.GetBitRate () > 0)
+    {
+      m_paceNextSend = Simulator::Now () + rate.CalculateBytesTxTime (m_paceBurstBytes);
+    }
+  m_paceBurstBytes = 0;
+}
+
+uint32_t
+RudpSocketImpl::GetRxWindow (void) const
+{
+  uint32_t used = m_rxAvailable + m_reassemblyBytes + m_reorderBytes;
+  return used < m_rcvBufSize ? m_rcvBufSize - used : 0;
+}
+
+bool
+RudpSocketImpl::IsDuplicate (uint32_t seq) const
+{
+  return RudpHeader::SequenceLessThan (seq, m_rxNextSeq)
+         || m_rxReceived.find (seq) != m_rxReceived.end ();
+}
+
+void
+RudpSocketImpl::RecordReceived (uint32_t seq)
+{
+  NS_LOG_FUNCTION (this << seq);
+  if (seq != m_rxNextSeq)
+    {
+      m_rxReceived.insert (seq);
+      return;
+    }
+  m_rxNextSeq = RudpHeader::IncrementSequence (m_rxNextSeq);
+  // Pull in the ranges that are now contiguous
+  while (!m_rxReceived.empty () && *m_rxReceived.begin () == m_rxNextSeq)
+    {
+      m_rxReceived.erase (m_rxReceived.begin ());
+      m_rxNextSeq = RudpHeader::IncrementSequence (m_rxNextSeq);
+    }
+}
+
+void
+RudpSocketImpl::ScheduleAck (const Address &toAddress)
+{
+  NS_LOG_FUNCTION (this << toAddress);
+
+  // The more packets arrive per ACK delay, the larger the sender's
+  // window: thin ACKs out to about four per window
+  Time now = Simulator::Now ();
+  m_ackWindowArrivals++;
+  if (now - m_ackWindowStart >= m_ackDelay)
+    {
+      m_ackCount = std::min (std::max (m_ackWindowArrivals / 4, m_ackFrequency), m_maxAckFrequency);
+      m_ackWindowStart = now;
+      m_ackWindowArrivals = 0;
+    }
+
+  m_ackPeer = toAddress;
+  if (++m_pendingAcks >= m_ackCount)
+    {
+      SendAck (toAddress);
+    }
+  else if (!m_ackEvent.IsRunning ())
+    {
+      m_ackEvent = Simulator::Schedule (m_ackDelay, &RudpSocketImpl::DelayedAck, this);
+    }
+}
+
+void
+RudpSocketImpl::DelayedAck (void)
+{
+  NS_LOG_FUNCTION (this);
+  SendAck (m_ackPeer);
+}
+
+void
+RudpSocketImpl::SendAck (const Address &toAddress)
+{
+  NS_LOG_FUNCTION (this << toAddress);
+
+  m_ackEvent.Cancel ();
+  m_pendingAcks = 0;
+
+  RudpSackHeader sack;
+  sack.SetCumulativeAck (m_rxNextSeq);
+  m_advertisedWindow = GetRxWindow ();
+  m_windowPeer = toAddress;
+  sack.SetWindow (m_advertisedWindow);
+  if (m_rxConnectionId != 0 && toAddress == m_rxConnectionPeer)
+    {
+      sack.SetConnectionId (m_rxConnectionId);
+    }
+  uint32_t ranges = 0;
+  std::set<uint32_t, SequenceLess>::const_iterator it = m_rxReceived.begin ();
+  while (it != m_rxReceived.end () && ranges < m_maxSackRanges)
+    {
+      uint32_t first = *it;
+      uint32_t last = first;
+      for (++it; it != m_rxReceived.end () && *it == RudpHeader::IncrementSequence (last); ++it)
+        {
+          last = *it;
+        }
+      sack.AddSackRange (first, last);
+      ranges++;
+    }
+
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (sack);
+
+  RudpHeader rudpHeader;
+  rudpHeader.SetControlFlag (true);
+  rudpHeader.SetTypeBits (RudpHeader::SACK);
+  SendPacket (p, rudpHeader, toAddress);
+}
+
+void
+RudpSocketImpl::SendNak (uint32_t first, uint32_t last, const Address &toAddress)
+{
+  NS_LOG_FUNCTION (this << first << last << toAddress);
+
+  RudpNakHeader nak;
+  nak.AddLossRange (first, last);
+
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (nak);
+
+  RudpHeader rudpHeader;
+  rudpHeader.SetControlFlag (true);
+  rudpHeader.SetTypeBits (RudpHeader::NAK);
+  SendPacket (p, rudpHeader, toAddress);
+}
+
+void
+RudpSocketImpl::SendDrop (uint32_t messageNumber, uint32_t first, uint32_t last, const Address &toAddress)
+{
+  NS_LOG_FUNCTION (this << messageNumber << first << last << toAddress);
+
+  RudpDropHeader drop;
+  drop.SetMessageNumber (messageNumber);
+  drop.SetDropRange (first, last);
+
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (drop);
+
+  RudpHeader rudpHeader;
+  rudpHeader.SetControlFlag (true);
+  rudpHeader.SetTypeBits (RudpHeader::DROP);
+  SendPacket (p, rudpHeader, toAddress);
+}
+
+void
+RudpSocketImpl::DiscardQueuedFragments (uint32_t messageNumber)
+{
+  NS_LOG_FUNCTION (this << messageNumber);
+  std::deque<PendingMessage>::iterator it = m_sendQueue.begin ();
+  while (it != m_sendQueue.end ())
+    {
+      if (it->m_messageNumber == messageNumber)
+        {
+          m_sendQueueBytes -= it->m_packet->GetSize ();
+          it = m_sendQueue.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
     }
 }
 
-void 
-RudpSocketImpl::ForwardUp6 (Ptr<Packet> packet, Ipv6Header header, uint16_t port, Ptr<Ipv6Interface> incomingInterface)
+void
+RudpSocketImpl::DropMessage (uint32_t messageNumber, const Address &toAddress)
 {
-  NS_LOG_FUNCTION (this << packet << header.GetSourceAddress () << port);
+  NS_LOG_FUNCTION (this << messageNumber << toAddress);
+  // The fragments not sent yet are given up on with the others, the one
+  // DROP covers them
+  DiscardQueuedFragments (messageNumber);
+  // The fragments of a message have consecutive sequence numbers. Keep
+  // them in the ring until the receiver acknowledges the DROP, so that a
+  // lost DROP is sent again.
+  Time now = Simulator::Now ();
+  bool found = false;
+  uint32_t first = 0;
+  uint32_t last = 0;
+  for (uint32_t seq = m_txFirstSeq; seq != m_nextTxSeq; seq = RudpHeader::IncrementSequence (seq))
+    {
+      TxItem &item = m_txRing[seq & m_txRingMask];
+      if (item.m_packet == 0 || item.m_header.GetMessageNumber () != messageNumber)
+        {
+          continue;
+        }
+      item.m_dropped = true;
+      item.m_sendTime = now;
+      item.m_retxCount++;
+      if (!found)
+        {
+          first = seq;
+          found = true;
+        }
+      last = seq;
+    }
+  if (!found)
+    {
+      // All the fragments sent were acknowledged. The DROP takes the
+      // sequence number of the next fragment and an empty placeholder
+      // holds it in the ring, to be resent until it is acknowledged too.
+      RudpHeader rudpHeader;
+      rudpHeader.SetSequenceNumber (m_nextTxSeq);
+      rudpHeader.SetMessageNumber (messageNumber);
+      first = last = m_nextTxSeq;
+      AddToTxBuffer (Create<Packet> (), rudpHeader, toAddress, Time (0));
+      m_txRing[first & m_txRingMask].m_dropped = true;
+    }
+  SendDrop (messageNumber, first, last, toAddress);
+}
 
-  if (m_shutdownRecv)
+void
+RudpSocketImpl::ProcessControl (Ptr<Packet> packet, const RudpHeader &rudpHeader,
+                                const Address &fromAddress)
+{
+  NS_LOG_FUNCTION (this << packet << fromAddress);
+  switch (rudpHeader.GetTypeBits ())
     {
-      return;
+    case RudpHeader::SACK:
+      {
+        RudpSackHeader sack;
+        packet->RemoveHeader (sack);
+        ProcessSack (sack, rudpHeader);
+        break;
+      }
+    case RudpHeader::NAK:
+      {
+        RudpNakHeader nak;
+        packet->RemoveHeader (nak);
+        ProcessNak (nak);
+        break;
+      }
+    case RudpHeader::DROP:
+      {
+        RudpDropHeader drop;
+        packet->RemoveHeader (drop);
+        ProcessDrop (drop, fromAddress);
+        break;
+      }
+    default:
+      NS_LOG_WARN ("Unknown control type " << (uint32_t) rudpHeader.GetTypeBits ());
+      break;
     }
+}
 
-  // Should check via getsockopt ()..
-  if (IsRecvPktInfo ())
+void
+RudpSocketImpl::ProcessSack (const RudpSackHeader &sack, const RudpHeader &rudpHeader)
+{
+  NS_LOG_FUNCTION (this << sack);
+
+  if (m_connected)
     {
-      Ipv6PacketInfoTag tag;
-      packet->RemovePacketTag (tag);
-      tag.SetRecvIf (incomingInterface->GetDevice ()->GetIfIndex ());
-      packet->AddPacketTag (tag);
+      m_peerConnectionId = sack.GetConnectionId ();
+    }
+  uint32_t txAvailable = GetTxAvailable ();
+  uint32_t bytesInFlight = m_bytesInFlight;
+  // A reordered SACK carries an older window, only take the window
+  // from SACKs acknowledging at least as much as the last one
+  if (!RudpHeader::SequenceLessThan (sack.GetCumulativeAck (), m_peerWindowAck))
+    {
+      m_peerWindow = sack.GetWindow ();
+      m_peerWindowAck = sack.GetCumulativeAck ();
     }
 
-  //Check only version 6 options
-  if (IsIpv6RecvTclass ())
+  // Everything below the cumulative ack has been received
+  Time newestSendTime;
+  ReleaseAcked (m_txFirstSeq, sack.GetCumulativeAck (), newestSendTime);
+
+  const RudpSequenceRangeList &ranges = sack.GetSackRanges ();
+  for (RudpSequenceRangeList::const_iterator r = ranges.begin (); r != ranges.end (); ++r)
     {
-      SocketIpv6TclassTag ipTclassTag;
-      ipTclassTag.SetTclass (header.GetTrafficClass ());
-      packet->AddPacketTag (ipTclassTag);
+      ReleaseAcked (r->first, RudpHeader::IncrementSequence (r->second), newestSendTime);
     }
 
-  if (IsIpv6RecvHopLimit ())
+  // Only SACKs releasing data measure the path: window updates and
+  // duplicate ACKs echo a timestamp that may have been held for long
+  bool released = m_bytesInFlight < bytesInFlight;
+  if (!rudpHeader.HasTimestamp ())
     {
-      SocketIpv6HopLimitTag ipHopLimitTag;
-      ipHopLimitTag.SetHopLimit (header.GetHopLimit ());
-      packet->AddPacketTag (ipHopLimitTag);
+      // The peer does not echo timestamps, stop sending them and fall back
+      // to the send times of packets that were never retransmitted
+      m_peerTimestamps = false;
+      if (!newestSendTime.IsZero ())
+        {
+          RttSample (Simulator::Now () - newestSendTime);
+        }
+    }
+  else if (released)
+    {
+      // Exact, even when the acknowledged packet was retransmitted
+      uint32_t elapsed = static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ())
+        - rudpHeader.GetTimestampEcho ();
+      RttSample (MicroSeconds (elapsed));
+      // From our timestamp to the arrival of the echoed packet on the
+      // peer's clock: the one-way delay plus the clock offset, without the
+      // time the ACK was held
+      int32_t delay = static_cast<int32_t> (rudpHeader.GetTimestamp () - rudpHeader.GetTimestampEcho ());
+      m_congestion->ForwardDelaySample (MicroSeconds (delay));
+    }
+  if (released)
+    {
+      m_congestion->PacketsAcked (bytesInFlight - m_bytesInFlight, m_bytesInFlight);
+      // The peer is making progress, give the rest a full RTO
+      m_probeOutstanding = false;
+      SetRetxTimer ();
     }
 
-  if ((m_rxAvailable + packet->GetSize ()) <= m_rcvBufSize)
+  DetectLosses ();
+  SetProbeTimer ();
+  if (m_txFirstSeq == m_nextTxSeq)
     {
-      Address address = Inet6SocketAddress (header.GetSourceAddress (), port);
-      SocketAddressTag tag;
-      tag.SetAddress (address);
-      packet->AddPacketTag (tag);
-      m_deliveryQueue.push (packet);
-      m_rxAvailable += packet->GetSize ();
-      NotifyDataRecv ();
+      // Nothing in flight, the timer restarts with the next packet
+      m_retxEvent.Cancel ();
+      m_rackDeadline = Time (0);
+      m_probeDeadline = Time (0);
     }
   else
     {
-      // In general, this case should not occur unless the
-      // receiving application reads data from this socket slowly
-      // in comparison to the arrival rate
-      //
-      // drop and trace packet
-      NS_LOG_WARN ("No receive buffer space available.  Drop.");
-      m_dropTrace (packet);
+      ArmTimer ();
+    }
+
+  SendPending ();
+  if (GetTxAvailable () > txAvailable)
+    {
+      NotifySend (GetTxAvailable ());
+    }
+}
+
+void
+RudpSocketImpl::ReleaseAcked (uint32_t first, uint32_t end, Time &newestSendTime)
+{
+  if (RudpHeader::SequenceLessThan (first, m_txFirstSeq))
+    {
+      first = m_txFirstSeq;
+    }
+  if (RudpHeader::SequenceLessThan (m_nextTxSeq, end))
+    {
+      end = m_nextTxSeq;
+    }
+  for (uint32_t seq = first; RudpHeader::SequenceLessThan (seq, end); seq = RudpHeader::IncrementSequence (seq))
+    {
+      TxItem &item = m_txRing[seq & m_txRingMask];
+      if (item.m_packet == 0)
+        {
+          continue;
+        }
+      if (item.m_retxCount == 0 && item.m_sendTime > newestSendTime)
+        {
+          newestSendTime = item.m_sendTime;
+        }
+      UpdateRack (item);
+      m_bytesInFlight -= item.m_packet->GetSize ();
+      item.m_packet = 0;
+    }
+  // The window starts at the oldest packet still unacknowledged
+  while (m_txFirstSeq != m_nextTxSeq && m_txRing[m_txFirstSeq & m_txRingMask].m_packet == 0)
+    {
+      m_txFirstSeq = RudpHeader::IncrementSequence (m_txFirstSeq);
+    }
+}
+
+void
+RudpSocketImpl::AddTimestamp (RudpHeader &rudpHeader) const
+{
+  if (!m_timestamps)
+    {
+      return;
+    }
+  if (rudpHeader.GetControlFlag ())
+    {
+      // Only echo if the peer sends timestamps itself
+      if (m_tsRecentValid)
+        {
+          rudpHeader.SetTimestamp (m_tsRecentArrival, m_tsRecent);
+        }
+    }
+  else if (m_peerTimestamps)
+    {
+      rudpHeader.SetTimestamp (static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ()), 0);
+    }
+}
+
+void
+RudpSocketImpl::UpdateTsRecent (const RudpHeader &rudpHeader, bool ackNow)
+{
+  if (!rudpHeader.HasTimestamp ())
+    {
+      m_tsRecentValid = false;
+      return;
+    }
+  // A delayed ACK echoes the oldest packet it acknowledges, so that the
+  // sample includes the time the ACK was held back
+  if (ackNow || m_pendingAcks == 0 || !m_tsRecentValid)
+    {
+      m_tsRecent = rudpHeader.GetTimestamp ();
+      m_tsRecentArrival = static_cast<uint32_t> (Simulator::Now ().GetMicroSeconds ());
+      m_tsRecentValid = true;
+    }
+}
+
+void
+RudpSocketImpl::RttSample (Time rtt)
+{
+  NS_LOG_FUNCTION (this << rtt);
+  m_lastRtt = rtt;
+  m_congestion->RttSample (rtt);
+
+  // RFC 6298. Samples are either echoed timestamps, exact even for
+  // retransmitted packets, or send times of packets never retransmitted:
+  // Karn's rule holds, and a sample ends the backoff
+  if (m_srtt.IsZero ())
+    {
+      m_srtt = rtt;
+      m_rttVar = rtt / 2;
+    }
+  else
+    {
+      Time delta = (m_srtt > rtt) ? m_srtt - rtt : rtt - m_srtt;
+      m_rttVar = (m_rttVar * 3 + delta) / 4;
+      m_srtt = (m_srtt * 7 + rtt) / 8;
+    }
+  m_rto = std::max (m_srtt + std::max (m_clockGranularity, m_rttVar * 4), m_minRto);
+  if (m_minRtt.IsZero () || rtt < m_minRtt)
+    {
+      m_minRtt = rtt;
+    }
+  m_rtoBackoff = 0;
+}
+
+void
+RudpSocketImpl::ProcessNak (const RudpNakHeader &nak)
+{
+  NS_LOG_FUNCTION (this << nak);
+
+  // The receiver reports a gap when the packet after it arrives. That
+  // packet was delivered, the ones in the gap may still be reordered:
+  // leave it to RACK to decide when they are lost.
+  const RudpSequenceRangeList &ranges = nak.GetLossRanges ();
+  for (RudpSequenceRangeList::const_iterator r = ranges.begin (); r != ranges.end (); ++r)
+    {
+      TxItem *item = FindTxItem (RudpHeader::IncrementSequence (r->second));
+      if (item != 0)
+        {
+          UpdateRack (*item);
+        }
+    }
+  DetectLosses ();
+  ArmTimer ();
+}
+
+void
+RudpSocketImpl::ProcessDrop (const RudpDropHeader &drop, const Address &fromAddress)
+{
+  NS_LOG_FUNCTION (this << drop << fromAddress);
+
+  // Every packet in flight holds a byte of the window we advertised, a
+  // range further ahead than the receive buffer cannot be genuine
+  uint32_t seq = drop.GetDropRange ().first;
+  uint32_t end = RudpHeader::IncrementSequence (drop.GetDropRange ().second);
+  if (RudpHeader::SequenceLessThan (end, seq)
+      || RudpHeader::SequenceOffset (m_rxNextSeq, end) > static_cast<int32_t> (m_rcvBufSize))
+    {
+      NS_LOG_LOGIC ("DROP range " << seq << "-" << drop.GetDropRange ().second << " out of the window, ignoring it");
+      return;
+    }
+
+  // Count the range as received, so that the cumulative ACK moves past it
+  // and no NAK reports it
+  if (RudpHeader::SequenceLessThan (seq, m_rxNextSeq))
+    {
+      seq = m_rxNextSeq;
+    }
+  for (; RudpHeader::SequenceLessThan (seq, end); seq = RudpHeader::IncrementSequence (seq))
+    {
+      if (!IsDuplicate (seq))
+        {
+          RecordReceived (seq);
+        }
+    }
+  if (RudpHeader::SequenceLessThan (m_rxHighSeq, end))
+    {
+      m_rxHighSeq = end;
+      m_rxMessageNumber = drop.GetMessageNumber ();
     }
+
+  std::map<uint32_t, uint32_t>::const_iterator found = m_reassembly.find (drop.GetMessageNumber ());
+  if (found != m_reassembly.end ())
+    {
+      NS_LOG_LOGIC ("Sender dropped message " << drop.GetMessageNumber () << ", discarding its fragments");
+      ReleaseReassembly (drop.GetMessageNumber ());
+    }
+  // The in-order messages may have been waiting for the dropped one
+  DeliverReordered ();
+  SendAck (fromAddress);
 }
 
 void
@@ -974,6 +2895,19 @@ RudpSocketImpl::ForwardIcmp (Ipv4Address icmpSource, uint8_t icmpTtl,
 {
   NS_LOG_FUNCTION (this << icmpSource << (uint32_t)icmpTtl << (uint32_t)icmpType <<
                    (uint32_t)icmpCode << icmpInfo);
+  if (icmpType == Icmpv4Header::DEST_UNREACH && icmpCode == Icmpv4DestinationUnreachable::FRAG_NEEDED
+      && icmpInfo > 20 + RudpHeader::MAX_HEADER_SIZE)
+    {
+      // icmpInfo is the next hop MTU, later fragments fit in it
+      m_pathMtuPayloadSize = std::min (m_pathMtuPayloadSize, icmpInfo - 20 - RudpHeader::MAX_HEADER_SIZE);
+      NS_LOG_LOGIC ("Path MTU " << icmpInfo << ", payload size " << GetMaxPayloadSize ());
+      m_congestion->SetSegmentSize (GetMaxPayloadSize ());
+    }
+  if (icmpType == Icmpv4Header::DEST_UNREACH)
+    {
+      // A router lost its route, ours may go through it
+      FlushRouteCache ();
+    }
   if (!m_icmpCallback.IsNull ())
     {
       m_icmpCallback (icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
@@ -987,6 +2921,18 @@ RudpSocketImpl::ForwardIcmp6 (Ipv6Address icmpSource, uint8_t icmpTtl,
 {
   NS_LOG_FUNCTION (this << icmpSource << (uint32_t)icmpTtl << (uint32_t)icmpType <<
                    (uint32_t)icmpCode << icmpInfo);
+  if (icmpType == Icmpv6Header::ICMPV6_ERROR_PACKET_TOO_BIG && icmpInfo > 40 + RudpHeader::MAX_HEADER_SIZE)
+    {
+      // icmpInfo is the MTU of the link, later fragments fit in it
+      m_pathMtuPayloadSize = std::min (m_pathMtuPayloadSize, icmpInfo - 40 - RudpHeader::MAX_HEADER_SIZE);
+      NS_LOG_LOGIC ("Path MTU " << icmpInfo << ", payload size " << GetMaxPayloadSize ());
+      m_congestion->SetSegmentSize (GetMaxPayloadSize ());
+    }
+  if (icmpType == Icmpv6Header::ICMPV6_ERROR_DESTINATION_UNREACHABLE)
+    {
+      // A router lost its route, ours may go through it
+      FlushRouteCache ();
+    }
   if (!m_icmpCallback6.IsNull ())
     {
       m_icmpCallback6 (icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
@@ -1005,6 +2951,136 @@ RudpSocketImpl::GetRcvBufSize (void) const
   return m_rcvBufSize;
 }
 
+void
+RudpSocketImpl::SetAckFrequency (uint32_t count)
+{
+  m_ackFrequency = count;
+  m_ackCount = std::max (m_ackCount, count);
+}
+
+uint32_t
+RudpSocketImpl::GetAckFrequency (void) const
+{
+  return m_ackFrequency;
+}
+
+void
+RudpSocketImpl::SetMaxAckFrequency (uint32_t count)
+{
+  m_maxAckFrequency = count;
+}
+
+uint32_t
+RudpSocketImpl::GetMaxAckFrequency (void) const
+{
+  return m_maxAckFrequency;
+}
+
+void
+RudpSocketImpl::SetAckDelay (Time timeout)
+{
+  m_ackDelay = timeout;
+}
+
+Time
+RudpSocketImpl::GetAckDelay (void) const
+{
+  return m_ackDelay;
+}
+
+void
+RudpSocketImpl::SetSndBufSize (uint32_t size)
+{
+  m_sndBufSize = size;
+}
+
+uint32_t
+RudpSocketImpl::GetSndBufSize (void) const
+{
+  return m_sndBufSize;
+}
+
+void
+RudpSocketImpl::SetSegmentSize (uint32_t size)
+{
+  m_segmentSize = size;
+  if (m_congestion != 0)
+    {
+      m_congestion->SetSegmentSize (GetMaxPayloadSize ());
+    }
+}
+
+uint32_t
+RudpSocketImpl::GetSegmentSize (void) const
+{
+  return m_segmentSize;
+}
+
+void
+RudpSocketImpl::SetMessageBundling (bool bundling)
+{
+  m_messageBundling = bundling;
+}
+
+bool
+RudpSocketImpl::GetMessageBundling (void) const
+{
+  return m_messageBundling;
+}
+
+void
+RudpSocketImpl::SetInOrderDelivery (bool inOrder)
+{
+  m_inOrderDelivery = inOrder;
+}
+
+bool
+RudpSocketImpl::GetInOrderDelivery (void) const
+{
+  return m_inOrderDelivery;
+}
+
+void
+RudpSocketImpl::SetMaxBundleSize (uint32_t size)
+{
+  m_maxBundleSize = size;
+}
+
+uint32_t
+RudpSocketImpl::GetMaxBundleSize (void) const
+{
+  return m_maxBundleSize;
+}
+
+void
+RudpSocketImpl::SetBundleDelay (Time delay)
+{
+  m_bundleDelay = delay;
+}
+
+Time
+RudpSocketImpl::GetBundleDelay (void) const
+{
+  return m_bundleDelay;
+}
+
+void
+RudpSocketImpl::SetCongestionControl (TypeId congestionControl)
+{
+  NS_LOG_FUNCTION (this << congestionControl);
+  ObjectFactory factory;
+  factory.SetTypeId (congestionControl);
+  m_congestion = factory.Create<RudpCongestionOps> ();
+  m_congestion->SetSegmentSize (GetMaxPayloadSize ());
+  m_congestionTypeId = congestionControl;
+}
+
+TypeId
+RudpSocketImpl::GetCongestionControl (void) const
+{
+  return m_congestionTypeId;
+}
+
 void 
 RudpSocketImpl::SetMtuDiscover (bool discover)
 {
@@ -1017,4 +3093,16 @@ RudpSocketImpl::GetMtuDiscover (void) const
   return m_mtuDiscover;
 }
 
+void
+RudpSocketImpl::SetTimestamps (bool timestamps)
+{
+  m_timestamps = timestamps;
+}
+
+bool
+RudpSocketImpl::GetTimestamps (void) const
+{
+  return m_timestamps;
+}
+
 } // namespace ns3
@@ -22,14 +22,25 @@
 
 #include <stdint.h>
 #include <queue>
+#include <deque>
+#include <set>
+#include <map>
+#include <vector>
 #include "ns3/callback.h"
 #include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 #include "ns3/socket.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
 #include "ns3/rudp-socket.h"
 #include "ns3/ipv4-interface.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/data-rate.h"
 #include "icmpv4.h"
+#include "rudp-header.h"
+#include "rudp-congestion-ops.h"
 
 namespace ns3 {
 
@@ -40,6 +51,11 @@ class Packet;
 class RudpL4Protocol;
 class Ipv6Header;
 class Ipv6Interface;
+class Ipv4Route;
+class Ipv6Route;
+class RudpSackHeader;
+class RudpNakHeader;
+class RudpDropHeader;
 
 /**
  * \ingroup rudp
@@ -47,6 +63,11 @@ class Ipv6Interface;
  * 
  * This class subclasses ns3::RudpSocket, and provides a socket interface
  * to ns3's implementation of RUDP.
+ *
+ * A socket runs a single sequence space in each direction, shared with
+ * one peer: the one it is connected to, or else the first one it sends
+ * data to or receives data from. Sending to another peer fails with
+ * ERROR_ISCONN, and packets from other peers are dropped.
  */
 
 class RudpSocketImpl : public RudpSocket
@@ -92,16 +113,147 @@ public:
   virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags);
   virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags,
                                 Address &fromAddress);
+  virtual int SendMany (const std::vector<Ptr<Packet> > &packets, uint32_t flags,
+                        const Address &address);
+  virtual uint32_t RecvMany (std::vector<Ptr<Packet> > &packets, std::vector<Address> &fromAddresses,
+                             uint32_t maxPackets, uint32_t flags);
   virtual int GetSockName (Address &address) const; 
   virtual int GetPeerName (Address &address) const;
   virtual void BindToNetDevice (Ptr<NetDevice> netdevice);
 
 private:
+  /**
+   * \brief Wrap-aware ordering of sequence numbers
+   */
+  struct SequenceLess
+  {
+    /**
+     * \param a the first sequence number
+     * \param b the second sequence number
+     * \return true if a comes before b
+     */
+    bool operator() (uint32_t a, uint32_t b) const
+    {
+      return RudpHeader::SequenceLessThan (a, b);
+    }
+  };
+
+  /**
+   * \brief A slot of the retransmission ring, holding a data packet sent
+   * but not yet acknowledged
+   */
+  struct TxItem
+  {
+    Ptr<Packet> m_packet;   //!< Packet, without RUDP header, kept for retransmission (0 if the slot is free)
+    RudpHeader m_header;    //!< RUDP header the packet is sent with
+    Address m_destination;  //!< Peer the packet is sent to
+    Time m_sendTime;        //!< Time of the last (re)transmission
+    uint32_t m_retxCount;   //!< Number of retransmissions
+    Time m_expiry;          //!< Time the message is given up on, zero if never
+    bool m_dropped;         //!< Given up on, a DROP is sent instead of the packet
+  };
+
+  /**
+   * \brief A message accepted by Send and waiting for the peer's window
+   */
+  struct PendingMessage
+  {
+    Ptr<Packet> m_packet;     //!< Message or fragment, with the tags set by DoSendTo
+    Address m_destination;    //!< Peer the message is sent to
+    uint32_t m_messageNumber; //!< Message number
+    uint8_t m_position;       //!< Position of the fragment in the message
+    Time m_expiry;            //!< Time the message is given up on, zero if never
+  };
+
+  /**
+   * \brief A complete in-order message waiting for the ones sent before
+   */
+  struct ReorderedMessage
+  {
+    Ptr<Packet> m_packet;   //!< Message
+    Address m_source;       //!< Address of the sender
+  };
+
+  /**
+   * \brief A route to a destination, reused until it expires or its
+   * interface goes down
+   */
+  struct Ipv4RouteCacheEntry
+  {
+    Ptr<Ipv4Route> m_route; //!< The route
+    Time m_expiry;          //!< When the route must be looked up again
+  };
+
+  /**
+   * \brief A route to a destination, reused until it expires or its
+   * interface goes down
+   */
+  struct Ipv6RouteCacheEntry
+  {
+    Ptr<Ipv6Route> m_route; //!< The route
+    Time m_expiry;          //!< When the route must be looked up again
+  };
+
+  /**
+   * \brief A fragment held in the slot pool
+   */
+  struct Fragment
+  {
+    uint32_t m_seq;  //!< Sequence number of the fragment
+    uint32_t m_slot; //!< First slot of the fragment's slot chain
+    uint32_t m_size; //!< Size of the fragment
+  };
+
+  /**
+   * \brief Fragments received of a message. Contexts are reused across
+   * messages, so their fragment lists keep their capacity
+   */
+  struct Reassembly
+  {
+    Reassembly ()
+      : m_firstSeq (0),
+        m_lastSeq (0),
+        m_size (0),
+        m_hasFirst (false),
+        m_hasLast (false)
+    {
+    }
+    std::vector<Fragment> m_fragments; //!< Fragments, in sequence order
+    Ptr<Packet> m_tags;  //!< Empty copy of the first fragment, carrying its packet tags
+    uint32_t m_firstSeq; //!< Sequence number of the first fragment
+    uint32_t m_lastSeq;  //!< Sequence number of the last fragment
+    uint32_t m_size;     //!< Bytes received of the message
+    bool m_hasFirst;     //!< The first fragment was received
+    bool m_hasLast;      //!< The last fragment was received
+  };
+
   // Attributes set through RudpSocket base class 
   virtual void SetRcvBufSize (uint32_t size);
   virtual uint32_t GetRcvBufSize (void) const;
+  virtual void SetSndBufSize (uint32_t size);
+  virtual uint32_t GetSndBufSize (void) const;
+  virtual void SetSegmentSize (uint32_t size);
+  virtual uint32_t GetSegmentSize (void) const;
+  virtual void SetAckFrequency (uint32_t count);
+  virtual uint32_t GetAckFrequency (void) const;
+  virtual void SetMaxAckFrequency (uint32_t count);
+  virtual uint32_t GetMaxAckFrequency (void) const;
+  virtual void SetAckDelay (Time timeout);
+  virtual Time GetAckDelay (void) const;
   virtual void SetMtuDiscover (bool discover);
   virtual bool GetMtuDiscover (void) const;
+  virtual void SetTimestamps (bool timestamps);
+  virtual bool GetTimestamps (void) const;
+  virtual void SetMessageBundling (bool bundling);
+  virtual bool GetMessageBundling (void) const;
+  virtual void SetMaxBundleSize (uint32_t size);
+  virtual uint32_t GetMaxBundleSize (void) const;
+  virtual void SetBundleDelay (Time delay);
+  virtual Time GetBundleDelay (void) const;
+  virtual void SetInOrderDelivery (bool inOrder);
+  virtual bool GetInOrderDelivery (void) const;
+  virtual void SetCongestionControl (TypeId congestionControl);
+  virtual TypeId GetCongestionControl (void) const;
 
 
   friend class RudpSocketFactory;
@@ -133,6 +285,17 @@ private:
    */
   void ForwardUp6 (Ptr<Packet> packet, Ipv6Header header, uint16_t port, Ptr<Ipv6Interface> incomingInterface);
 
+  /**
+   * \brief Process a received RUDP packet, common to IPv4 and IPv6
+   *
+   * Removes the RUDP header, dispatches control packets and acknowledges
+   * and delivers data packets.
+   *
+   * \param packet the incoming packet, starting with its RUDP header
+   * \param fromAddress the address of the sender
+   */
+  void DoForwardUp (Ptr<Packet> packet, const Address &fromAddress);
+
   /**
    * \brief Kill this socket by zeroing its attributes (IPv4)
    *
@@ -183,6 +346,436 @@ private:
    * \returns 0 on success, -1 on failure
    */
   int DoSendTo (Ptr<Packet> p, Ipv6Address daddr, uint16_t dport);
+  /**
+   * \brief Send a batch of messages to a specific destination and port (IPv4)
+   * \param packets the messages
+   * \param daddr destination address
+   * \param dport destination port
+   * \returns the number of messages accepted, -1 if none was
+   */
+  int DoSendManyTo (const std::vector<Ptr<Packet> > &packets, Ipv4Address daddr, uint16_t dport);
+  /**
+   * \brief Send a batch of messages to a specific destination and port (IPv6)
+   * \param packets the messages
+   * \param daddr destination address
+   * \param dport destination port
+   * \returns the number of messages accepted, -1 if none was
+   */
+  int DoSendManyTo (const std::vector<Ptr<Packet> > &packets, Ipv6Address daddr, uint16_t dport);
+  /**
+   * \brief Tell the peer our window reopened, once the application has
+   * read enough
+   */
+  void UpdateWindow (void);
+
+  /**
+   * \brief Hand a packet with its RUDP header to the L4 protocol (IPv4)
+   * \param p packet
+   * \param rudpHeader RUDP header, ports are filled in by the L4 protocol
+   * \param daddr destination address
+   * \param dport destination port
+   * \returns 0 on success, -1 on failure
+   */
+  int SendPacket (Ptr<Packet> p, const RudpHeader &rudpHeader, Ipv4Address daddr, uint16_t dport);
+  /**
+   * \brief Hand a packet with its RUDP header to the L4 protocol (IPv6)
+   * \param p packet
+   * \param rudpHeader RUDP header, ports are filled in by the L4 protocol
+   * \param daddr destination address
+   * \param dport destination port
+   * \returns 0 on success, -1 on failure
+   */
+  int SendPacket (Ptr<Packet> p, const RudpHeader &rudpHeader, Ipv6Address daddr, uint16_t dport);
+  /**
+   * \brief Hand a packet with its RUDP header to the L4 protocol
+   * \param p packet
+   * \param rudpHeader RUDP header, ports are filled in by the L4 protocol
+   * \param address destination InetSocketAddress or Inet6SocketAddress
+   * \returns 0 on success, -1 on failure
+   */
+  int SendPacket (Ptr<Packet> p, const RudpHeader &rudpHeader, const Address &address);
+
+  /**
+   * \brief Number and send a new data packet
+   *
+   * Fills in the sequence number, the connection ID if the compact header
+   * can be used and the payload checksum.
+   *
+   * \param p packet
+   * \param rudpHeader RUDP header, with the message number and flags already set
+   * \param address destination InetSocketAddress or Inet6SocketAddress
+   * \returns 0 on success, -1 on failure
+   */
+  int SendDataPacket (Ptr<Packet> p, RudpHeader &rudpHeader, const Address &address);
+  /**
+   * \brief Get a route to a destination, from the cache or from the
+   * routing protocol
+   * \param p the packet to send
+   * \param dest the destination
+   * \param errno_ set to the routing error if there is no route
+   * \returns the route, 0 if there is none
+   */
+  Ptr<Ipv4Route> LookupRoute (Ptr<Packet> p, Ipv4Address dest, Socket::SocketErrno &errno_);
+  /**
+   * \brief Get a route to a destination, from the cache or from the
+   * routing protocol
+   * \param p the packet to send
+   * \param dest the destination
+   * \param errno_ set to the routing error if there is no route
+   * \returns the route, 0 if there is none
+   */
+  Ptr<Ipv6Route> LookupRoute (Ptr<Packet> p, Ipv6Address dest, Socket::SocketErrno &errno_);
+  /**
+   * \brief Forget the cached routes
+   */
+  void FlushRouteCache (void);
+  /**
+   * \brief Get the largest payload of a data packet
+   * \returns the SegmentSize attribute, lowered to fit the path MTU
+   */
+  uint32_t GetMaxPayloadSize (void) const;
+  /**
+   * \brief Split a message in fragments, and send them or queue them
+   * until the peer's window opens
+   * \param p the message
+   * \param address destination InetSocketAddress or Inet6SocketAddress
+   * \returns 0 on success, -1 on failure
+   */
+  int QueueMessage (Ptr<Packet> p, const Address &address);
+  /**
+   * \brief Check that an address is the peer's, making it the peer if
+   * the socket has none yet
+   * \param address InetSocketAddress or Inet6SocketAddress
+   * \returns true if the address is the peer's
+   */
+  bool MatchPeer (const Address &address);
+  /**
+   * \brief Send a message or fragment, or add it to the bundle being built
+   * \param p the message or fragment
+   * \param messageNumber the message number
+   * \param position the position of the fragment in the message
+   * \param expiry the time the message is given up on, zero if never
+   * \param address destination InetSocketAddress or Inet6SocketAddress
+   * \param accepted true if the message was already accepted from the
+   * application, it is then kept for retransmission even if it could not be sent
+   * \returns 0 on success, -1 on failure
+   */
+  int SendFragment (Ptr<Packet> p, uint32_t messageNumber, uint8_t position, Time expiry,
+                    const Address &address, bool accepted);
+  /**
+   * \brief Send the queued messages the peer's window lets out
+   */
+  void SendPending (void);
+  /**
+   * \brief Append a small message to the bundle being built
+   *
+   * The bundle is sent once it is full, when a message for another
+   * destination or too large to be bundled is sent, or m_bundleDelay
+   * after its first message.
+   *
+   * \param p the message
+   * \param messageNumber the message number
+   * \param expiry the time the message is given up on, zero if never
+   * \param address destination InetSocketAddress or Inet6SocketAddress
+   */
+  void AddToBundle (Ptr<Packet> p, uint32_t messageNumber, Time expiry, const Address &address);
+  /**
+   * \brief Send the bundle being built, if any
+   */
+  void FlushBundle (void);
+  /**
+   * \brief Queue a received message for the application
+   * \param packet the message
+   * \param fromAddress the address of the sender
+   */
+  void Deliver (Ptr<Packet> packet, const Address &fromAddress);
+  /**
+   * \brief Deliver a complete message, or hold it in the reorder buffer
+   * \param packet the message
+   * \param fromAddress the address of the sender
+   * \param lastSeq the sequence number of the last fragment of the message
+   * \param inOrder true if the message is flagged as in-order
+   */
+  void DeliverMessage (Ptr<Packet> packet, const Address &fromAddress, uint32_t lastSeq, bool inOrder);
+  /**
+   * \brief Deliver the in-order messages no sequence number is missing before
+   */
+  void DeliverReordered (void);
+  /**
+   * \brief Split a received bundle and deliver its messages
+   * \param packet the payload of the bundle
+   * \param rudpHeader the RUDP header of the bundle
+   * \param fromAddress the address of the sender
+   */
+  void DeliverBundle (Ptr<Packet> packet, const RudpHeader &rudpHeader, const Address &fromAddress);
+  /**
+   * \brief Get the part of the peer's window not used by packets in flight
+   * \returns the space in bytes
+   */
+  uint32_t GetSendWindowSpace (void) const;
+  /**
+   * \brief Check whether the peer's window lets a message out
+   * \param size the size of the message
+   * \returns true if the message can be sent now
+   */
+  bool IsSendWindowOpen (uint32_t size) const;
+  /**
+   * \brief Keep a fragment until its message is complete, then deliver it
+   * \param packet the fragment
+   * \param rudpHeader the RUDP header of the fragment
+   * \param fromAddress the address of the sender
+   */
+  void Reassemble (Ptr<Packet> packet, const RudpHeader &rudpHeader, const Address &fromAddress);
+  /**
+   * \brief Copy a fragment into a chain of pool slots
+   * \param packet the fragment
+   * \returns the first slot of the chain
+   */
+  uint32_t StoreFragment (Ptr<Packet> packet);
+  /**
+   * \brief Return a chain of slots to the pool
+   * \param slot the first slot of the chain
+   */
+  void FreeFragmentSlots (uint32_t slot);
+  /**
+   * \brief Release the fragments of a message and its context
+   * \param messageNumber the message number
+   */
+  void ReleaseReassembly (uint32_t messageNumber);
+  /**
+   * \brief Get the free space of the receive buffer, advertised to the peer
+   * \returns the space in bytes
+   */
+  uint32_t GetRxWindow (void) const;
+  /**
+   * \brief Get the send window
+   * \returns the smaller of the peer's window and the congestion window
+   */
+  uint32_t GetSendWindow (void) const;
+  /**
+   * \brief Report a lost packet to the congestion controller, once per
+   * congestion event
+   * \param seq the sequence number of the lost packet
+   */
+  void PacketLost (uint32_t seq);
+  /**
+   * \brief Get the rate new data is paced at
+   * \returns the congestion controller's rate, or the send window over the
+   * RTT, 0 when there is no RTT sample yet
+   */
+  DataRate GetPacingRate (void) const;
+  /**
+   * \brief Check if new data is paced
+   * \returns true if pacing is enabled or the congestion controller sets
+   * a rate
+   */
+  bool IsPacing (void) const;
+  /**
+   * \brief Check if the pacer lets new data leave now. If not, the pacing
+   * timer is set to send the queued data when it does
+   * \returns true if new data can be sent
+   */
+  bool IsPacingOpen (void);
+  /**
+   * \brief Count new data sent against the current burst
+   * \param size the size of the data packet
+   */
+  void PaceSent (uint32_t size);
+  /**
+   * \brief Check whether data packets to a destination may use the
+   * compact header
+   *
+   * That is the case once the socket is connected to that destination and
+   * the peer has handed out a connection ID, as long as the packets in
+   * flight fit in the range of the truncated sequence numbers.
+   *
+   * \param address the InetSocketAddress or Inet6SocketAddress of the destination
+   * \returns true if the compact header can be used
+   */
+  bool UseCompactHeader (const Address &address) const;
+  /**
+   * \brief Keep a sent data packet until it is acknowledged
+   * \param p the packet (without RUDP header)
+   * \param rudpHeader the RUDP header it was sent with
+   * \param address the InetSocketAddress or Inet6SocketAddress it was sent to
+   * \param expiry the time its message is given up on, zero if never
+   */
+  void AddToTxBuffer (Ptr<Packet> p, const RudpHeader &rudpHeader, const Address &address,
+                      Time expiry);
+  /**
+   * \brief Record a received data sequence number
+   * \param seq the sequence number
+   */
+  void RecordReceived (uint32_t seq);
+  /**
+   * \brief Check whether a data sequence number has already been received
+   * \param seq the sequence number
+   * \returns true if seq is a duplicate
+   */
+  bool IsDuplicate (uint32_t seq) const;
+  /**
+   * \brief Send a SACK describing the received sequence space
+   * \param toAddress the peer to acknowledge
+   */
+  void SendAck (const Address &toAddress);
+  /**
+   * \brief Account for a data packet received in order, and acknowledge
+   * it once the ACK policy says so
+   *
+   * An ACK is sent every m_ackCount packets or m_ackDelay after the first
+   * unacknowledged packet, whichever comes first. m_ackCount grows from
+   * m_ackFrequency up to m_maxAckFrequency with the number of packets
+   * received per m_ackDelay, which follows the sender's window.
+   *
+   * \param toAddress the peer to acknowledge
+   */
+  void ScheduleAck (const Address &toAddress);
+  /**
+   * \brief Send the ACK held back by ScheduleAck
+   */
+  void DelayedAck (void);
+  /**
+   * \brief Report a gap in the received sequence space
+   * \param first the first missing sequence number
+   * \param last the last missing sequence number
+   * \param toAddress the peer to report to
+   */
+  void SendNak (uint32_t first, uint32_t last, const Address &toAddress);
+  /**
+   * \brief Tell the receiver a message is no longer retransmitted
+   * \param messageNumber the message number
+   * \param first the first sequence number given up on
+   * \param last the last sequence number given up on
+   * \param toAddress the peer to tell
+   */
+  void SendDrop (uint32_t messageNumber, uint32_t first, uint32_t last, const Address &toAddress);
+  /**
+   * \brief Give up on a message that outlived its time-to-live
+   *
+   * The fragments in flight stay in the ring, flagged as dropped, until
+   * the DROP is acknowledged. A lost DROP is resent once for all of them.
+   *
+   * \param messageNumber the message number
+   * \param toAddress the peer the message is sent to
+   */
+  void DropMessage (uint32_t messageNumber, const Address &toAddress);
+  /**
+   * \brief Remove the fragments of a message from the send queue
+   * \param messageNumber the message number
+   */
+  void DiscardQueuedFragments (uint32_t messageNumber);
+  /**
+   * \brief Process a received control packet
+   * \param packet the control payload
+   * \param rudpHeader the RUDP header of the packet
+   * \param fromAddress the peer the packet came from
+   */
+  void ProcessControl (Ptr<Packet> packet, const RudpHeader &rudpHeader, const Address &fromAddress);
+  /**
+   * \brief Release acknowledged packets and retransmit the missing ones
+   * \param sack the received SACK
+   * \param rudpHeader the RUDP header of the SACK
+   */
+  void ProcessSack (const RudpSackHeader &sack, const RudpHeader &rudpHeader);
+  /**
+   * \brief Release the packets of the retransmission ring in [first, end)
+   * \param first the sequence number of the first packet to release
+   * \param end the sequence number following the last one to release
+   * \param newestSendTime updated with the latest send time of the released
+   * packets that were never retransmitted
+   */
+  void ReleaseAcked (uint32_t first, uint32_t end, Time &newestSendTime);
+  /**
+   * \brief Add the timestamp option to an outgoing header, if negotiated
+   *
+   * Control packets carry the arrival time of the packet they echo rather
+   * than their send time, so that the peer's forward delay samples leave
+   * out the time an ACK was held back.
+   *
+   * \param rudpHeader the header
+   */
+  void AddTimestamp (RudpHeader &rudpHeader) const;
+  /**
+   * \brief Remember the timestamp of a received data packet for echoing
+   * \param rudpHeader the RUDP header of the data packet
+   * \param ackNow true if the packet is acknowledged right away
+   */
+  void UpdateTsRecent (const RudpHeader &rudpHeader, bool ackNow);
+  /**
+   * \brief Account for a new RTT sample
+   * \param rtt the sample
+   */
+  void RttSample (Time rtt);
+  /**
+   * \brief Account for the packet that revealed a gap at the receiver
+   * \param nak the received NAK
+   */
+  void ProcessNak (const RudpNakHeader &nak);
+  /**
+   * \brief Skip a message the sender gave up on
+   * \param drop the received DROP
+   * \param fromAddress the address of the sender
+   */
+  void ProcessDrop (const RudpDropHeader &drop, const Address &fromAddress);
+  /**
+   * \brief Find a packet of the retransmission ring
+   * \param seq the sequence number of the packet
+   * \returns the slot of the packet, 0 if it is not in flight
+   */
+  TxItem * FindTxItem (uint32_t seq);
+  /**
+   * \brief Double the size of the retransmission ring
+   */
+  void GrowTxRing (void);
+  /**
+   * \brief Retransmit a packet of the transmission buffer
+   * \param seq the sequence number of the packet
+   */
+  void Retransmit (uint32_t seq);
+  /**
+   * \brief Get the retransmission timeout, backed off
+   * \returns the timeout
+   */
+  Time GetRto (void) const;
+  /**
+   * \brief Push the retransmission timeout one RTO from now
+   */
+  void SetRetxTimer (void);
+  /**
+   * \brief Set the tail loss probe deadline, if a probe may be sent
+   */
+  void SetProbeTimer (void);
+  /**
+   * \brief Send a tail loss probe, to draw a SACK or NAK from the peer
+   */
+  void SendProbe (void);
+  /**
+   * \brief Make the socket timer expire at the earliest of its deadlines
+   */
+  void ArmTimer (void);
+  /**
+   * \brief The socket timer expired, handle the deadlines that passed
+   */
+  void TimerExpired (void);
+  /**
+   * \brief The retransmission timeout expired
+   */
+  void RetxTimeout (void);
+  /**
+   * \brief Account for a packet delivered to the peer in the RACK state
+   * \param item the delivered packet
+   */
+  void UpdateRack (const TxItem &item);
+  /**
+   * \brief Get the time a packet may arrive after one sent later
+   * \returns the reordering window
+   */
+  Time GetReorderWindow (void) const;
+  /**
+   * \brief Retransmit the packets sent a reordering window before the
+   * last one delivered, and set the RACK deadline for the others
+   */
+  void DetectLosses (void);
 
   /**
    * \brief Called by the L3 protocol when it received an ICMP packet to pass on to TCP.
@@ -226,9 +819,123 @@ private:
   std::queue<Ptr<Packet> > m_deliveryQueue; //!< Queue for incoming packets
   uint32_t m_rxAvailable;                   //!< Number of available bytes to be received
 
+  // Reliability state, a socket runs a single sequence space with its peer
+  Address m_peer;                                //!< Peer the sequence spaces are shared with, invalid until known
+  uint32_t m_nextTxSeq;                          //!< Next sequence number to send
+  uint32_t m_nextMessageNumber;                  //!< Next message number to send
+  std::vector<TxItem> m_txRing;                  //!< Sent but unacknowledged packets, by sequence number modulo the size
+  uint32_t m_txRingMask;                         //!< Size of m_txRing minus one, the size is a power of two
+  uint32_t m_txFirstSeq;                         //!< Oldest unacknowledged sequence number
+  uint32_t m_rxNextSeq;                          //!< Next in-order sequence number expected
+  std::set<uint32_t, SequenceLess> m_rxReceived; //!< Sequence numbers received above m_rxNextSeq
+  uint32_t m_maxSackRanges;                      //!< Maximum number of ranges in a SACK
+  uint32_t m_rxHighSeq;                          //!< Sequence number following the highest received
+  uint32_t m_rxMessageNumber;                    //!< Message number of the highest sequence received
+  uint16_t m_rxConnectionId;                     //!< Connection ID handed out to the peer
+  Address m_rxConnectionPeer;                    //!< Peer the connection ID is handed out to
+  uint16_t m_peerConnectionId;                   //!< Connection ID handed out by the peer
+
+  // Flow control
+  uint32_t m_bytesInFlight;    //!< Bytes sent and not yet acknowledged
+  uint32_t m_peerWindow;       //!< Receive window advertised by the peer
+  uint32_t m_peerWindowAck;    //!< Cumulative ACK of the SACK m_peerWindow was taken from
+  uint32_t m_advertisedWindow; //!< Receive window last advertised to the peer
+  Address m_windowPeer;        //!< Peer the window was advertised to
+  std::deque<PendingMessage> m_sendQueue; //!< Messages waiting for the peer's window
+  uint32_t m_sendQueueBytes;              //!< Bytes in m_sendQueue
+  uint32_t m_pathMtuPayloadSize;          //!< Largest payload fitting the path MTU reported by ICMP
+
+  // Reassembly
+  std::vector<uint8_t> m_fragmentSlots;      //!< Slot pool, FRAGMENT_SLOT_SIZE bytes per slot
+  std::vector<uint32_t> m_fragmentSlotNext;  //!< Next slot in a fragment's chain or in the free list
+  uint32_t m_freeFragmentSlot;               //!< Head of the free slot list
+  std::vector<Reassembly> m_reassemblies;    //!< Reassembly contexts
+  std::vector<uint32_t> m_freeReassemblies;  //!< Unused reassembly contexts
+  std::map<uint32_t, uint32_t> m_reassembly; //!< Incomplete messages, message number to context
+  uint32_t m_reassemblyBytes;                //!< Bytes of the incomplete messages
+  std::vector<uint8_t> m_reassemblyScratch;  //!< Contiguous copy of the message being completed
+
+  // In-order delivery
+  std::multimap<uint32_t, ReorderedMessage, SequenceLess> m_reorderBuffer; //!< In-order messages, by last sequence number
+  uint32_t m_reorderBytes;                                                 //!< Bytes in m_reorderBuffer
+
+  // RTT timestamp option
+  bool m_peerTimestamps;      //!< The peer has not refused the timestamp option
+  bool m_tsRecentValid;       //!< m_tsRecent holds a timestamp to echo
+  uint32_t m_tsRecent;        //!< Timestamp to echo in the next ACK
+  uint32_t m_tsRecentArrival; //!< Local time m_tsRecent arrived, in microseconds
+  TracedValue<Time> m_lastRtt; //!< Last RTT sample
+
+  // Retransmission timer
+  Time m_srtt;                 //!< Smoothed RTT, zero until the first sample
+  Time m_rttVar;               //!< RTT variation
+  TracedValue<Time> m_rto;     //!< Retransmission timeout, before backoff
+  Time m_initialRto;           //!< Retransmission timeout until the first RTT sample
+  uint32_t m_rtoBackoff;       //!< Timeouts since the last RTT sample
+  Time m_minRto;               //!< Lowest retransmission timeout
+  Time m_maxRto;               //!< Highest retransmission timeout, backoff included
+  Time m_clockGranularity;     //!< Clock granularity used in the RTO
+  EventId m_retxEvent;         //!< Socket timer, for all the deadlines below
+  Time m_retxDeadline;         //!< Time the retransmission timeout expires
+
+  // RACK loss detection
+  Time m_minRtt;               //!< Lowest RTT sample
+  Time m_rackSendTime;         //!< Send time of the last packet delivered
+  Time m_rackRtt;              //!< RTT of the last packet delivered
+  Time m_rackDeadline;         //!< Time the next packet may be declared lost, zero if none
+  double m_reorderWindowFactor; //!< Reordering window, as a fraction of the lowest RTT
+
+  // Tail loss probe
+  bool m_tailLossProbe;        //!< Send probes before the retransmission timeout
+  Time m_probeDeadline;        //!< Time the probe is sent, zero if none
+  bool m_probeOutstanding;     //!< A probe was sent and nothing acknowledged since
+
+  // Route cache, used when the socket is not bound to a local address
+  std::map<Ipv4Address, Ipv4RouteCacheEntry> m_ipv4RouteCache; //!< IPv4 routes, by destination
+  std::map<Ipv6Address, Ipv6RouteCacheEntry> m_ipv6RouteCache; //!< IPv6 routes, by destination
+  Time m_routeCacheTimeout;                                    //!< Lifetime of a cached route
+
+  // ACK policy
+  EventId m_ackEvent;           //!< Delayed ACK timer
+  Address m_ackPeer;            //!< Peer the delayed ACK is for
+  uint32_t m_pendingAcks;       //!< Data packets received since the last ACK
+  uint32_t m_ackCount;          //!< Current number of packets per ACK
+  Time m_ackWindowStart;        //!< Start of the current arrival count window
+  uint32_t m_ackWindowArrivals; //!< Data packets received in the current window
+
+  // Message bundling
+  Ptr<Packet> m_bundle;           //!< Bundle being built, chunks of the messages
+  Address m_bundleDestination;    //!< Peer the bundle is for
+  uint32_t m_bundleMessageNumber; //!< Message number of the last bundled message
+  uint32_t m_bundleMessageBytes;  //!< Bytes of the bundled messages, without their chunk headers
+  Time m_bundleExpiry;            //!< Time all the bundled messages are given up on, zero if never
+  EventId m_bundleEvent;          //!< Timer sending the bundle
+
+  // Congestion control
+  Ptr<RudpCongestionOps> m_congestion; //!< Congestion controller
+  TypeId m_congestionTypeId;           //!< TypeId of the congestion controller
+  uint32_t m_recoverySeq;              //!< Losses below it belong to the last congestion event
+
+  // Pacing
+  bool m_pacing;              //!< New data is paced
+  uint32_t m_pacingBurst;     //!< Bytes sent back to back before the pacer waits
+  uint32_t m_paceBurstBytes;  //!< Bytes sent in the current burst
+  Time m_paceNextSend;        //!< Time the next burst may leave
+  EventId m_paceEvent;        //!< Pacing timer, sends the queued data
+
   // Socket attributes
   uint32_t m_rcvBufSize;    //!< Receive buffer size
+  uint32_t m_sndBufSize;    //!< Send buffer size
+  uint32_t m_segmentSize;   //!< Largest payload of a data packet
+  uint32_t m_ackFrequency;    //!< Minimum number of packets per ACK
+  uint32_t m_maxAckFrequency; //!< Maximum number of packets per ACK
+  Time m_ackDelay;            //!< Maximum ACK delay
   bool m_mtuDiscover;       //!< Allow MTU discovery
+  bool m_timestamps;        //!< Timestamp option enabled
+  bool m_messageBundling;   //!< Small messages are bundled
+  uint32_t m_maxBundleSize; //!< Largest payload of a bundle
+  Time m_bundleDelay;       //!< Longest time a message waits in a bundle
+  bool m_inOrderDelivery;   //!< Messages sent are flagged as in-order
 };
 
 } // namespace ns3
@@ -23,8 +23,10 @@
 #include "ns3/uinteger.h"
 #include "ns3/integer.h"
 #include "ns3/boolean.h"
+#include "ns3/nstime.h"
 #include "ns3/trace-source-accessor.h"
-#include "udp-socket.h"
+#include "rudp-socket.h"
+#include "rudp-congestion-ops.h"
 
 namespace ns3 {
 
@@ -44,17 +46,89 @@ RudpSocket::GetTypeId (void)
                    MakeUintegerAccessor (&RudpSocket::GetRcvBufSize,
                                          &RudpSocket::SetRcvBufSize),
                    MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SndBufSize",
+                   "RudpSocket maximum send buffer size (bytes), "
+                   "unsent and unacknowledged data",
+                   UintegerValue (131072),
+                   MakeUintegerAccessor (&RudpSocket::GetSndBufSize,
+                                         &RudpSocket::SetSndBufSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("SegmentSize",
+                   "Largest payload of a data packet (bytes), larger messages are "
+                   "fragmented. Lowered further by ICMP path MTU reports",
+                   UintegerValue (1400),
+                   MakeUintegerAccessor (&RudpSocket::GetSegmentSize,
+                                         &RudpSocket::SetSegmentSize),
+                   MakeUintegerChecker<uint32_t> (64))
+    .AddAttribute ("AckFrequency",
+                   "Minimum number of data packets acknowledged by one ACK",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&RudpSocket::GetAckFrequency,
+                                         &RudpSocket::SetAckFrequency),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxAckFrequency",
+                   "Maximum number of data packets acknowledged by one ACK, "
+                   "reached as the sender's window grows",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&RudpSocket::GetMaxAckFrequency,
+                                         &RudpSocket::SetMaxAckFrequency),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("AckDelay",
+                   "Longest time a received data packet waits for its ACK",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&RudpSocket::GetAckDelay,
+                                     &RudpSocket::SetAckDelay),
+                   MakeTimeChecker ())
     .AddAttribute ("IpTtl",
                    "socket-specific TTL for unicast IP packets (if non-zero)",
                    UintegerValue (0),
-                   MakeUintegerAccessor (&UdpSocket::GetIpTtl,
-                                         &UdpSocket::SetIpTtl),
+                   MakeUintegerAccessor (&RudpSocket::GetIpTtl,
+                                         &RudpSocket::SetIpTtl),
                    MakeUintegerChecker<uint8_t> ())
     .AddAttribute ("MtuDiscover", "If enabled, every outgoing ip packet will have the DF flag set.",
                    BooleanValue (false),
-                   MakeBooleanAccessor (&UdpSocket::SetMtuDiscover,
-                                        &UdpSocket::GetMtuDiscover),
+                   MakeBooleanAccessor (&RudpSocket::SetMtuDiscover,
+                                        &RudpSocket::GetMtuDiscover),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Timestamps",
+                   "Enable the RTT timestamp option, used if the peer enables it as well",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&RudpSocket::SetTimestamps,
+                                        &RudpSocket::GetTimestamps),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MessageBundling",
+                   "Bundle small messages sent to the same peer into one packet",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RudpSocket::SetMessageBundling,
+                                        &RudpSocket::GetMessageBundling),
                    MakeBooleanChecker ())
+    .AddAttribute ("MaxBundleSize",
+                   "Largest payload of a bundle of messages (bytes), "
+                   "larger messages are sent on their own",
+                   UintegerValue (1400),
+                   MakeUintegerAccessor (&RudpSocket::GetMaxBundleSize,
+                                         &RudpSocket::SetMaxBundleSize),
+                   MakeUintegerChecker<uint32_t> (64, 65507))
+    .AddAttribute ("BundleDelay",
+                   "Longest time a message waits for others to be bundled with, "
+                   "0 only bundles the messages sent at the same time",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&RudpSocket::GetBundleDelay,
+                                     &RudpSocket::SetBundleDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("InOrderDelivery",
+                   "Flag the messages sent as in-order: the receiver holds them back "
+                   "until the in-order messages sent before are delivered",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RudpSocket::SetInOrderDelivery,
+                                        &RudpSocket::GetInOrderDelivery),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CongestionControl",
+                   "TypeId of the congestion controller, a subclass of RudpCongestionOps",
+                   TypeIdValue (RudpDaimd::GetTypeId ()),
+                   MakeTypeIdAccessor (&RudpSocket::GetCongestionControl,
+                                       &RudpSocket::SetCongestionControl),
+                   MakeTypeIdChecker ())
   ;
   return tid;
 }
@@ -69,4 +143,63 @@ RudpSocket::~RudpSocket ()
   NS_LOG_FUNCTION_NOARGS ();
 }
 
+NS_OBJECT_ENSURE_REGISTERED (RudpMessageTtlTag);
+
+RudpMessageTtlTag::RudpMessageTtlTag ()
+{
+}
+
+void
+RudpMessageTtlTag::SetTtl (Time ttl)
+{
+  m_ttl = ttl;
+}
+
+Time
+RudpMessageTtlTag::GetTtl (void) const
+{
+  return m_ttl;
+}
+
+TypeId
+RudpMessageTtlTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RudpMessageTtlTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<RudpMessageTtlTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+RudpMessageTtlTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+RudpMessageTtlTag::GetSerializedSize (void) const
+{
+  return 8;
+}
+
+void
+RudpMessageTtlTag::Serialize (TagBuffer i) const
+{
+  i.WriteU64 (m_ttl.GetTimeStep ());
+}
+
+void
+RudpMessageTtlTag::Deserialize (TagBuffer i)
+{
+  m_ttl = TimeStep (i.ReadU64 ());
+}
+
+void
+RudpMessageTtlTag::Print (std::ostream &os) const
+{
+  os << "Ttl=" << m_ttl.GetSeconds () << "s";
+}
+
 } // namespace ns3
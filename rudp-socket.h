@@ -27,6 +27,9 @@
 #include "ns3/callback.h"
 #include "ns3/ptr.h"
 #include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/tag.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -55,6 +58,33 @@ public:
   RudpSocket (void);
   virtual ~RudpSocket (void);
 
+  /**
+   * \brief Send a batch of messages to the same destination
+   *
+   * Messages are accepted in order until one does not fit the send
+   * buffer, as if each had been passed to SendTo.
+   *
+   * \param packets the messages
+   * \param flags Socket control flags
+   * \param address the destination, InetSocketAddress or Inet6SocketAddress
+   * \returns the number of messages accepted, -1 if none was (GetErrno
+   * tells why)
+   */
+  virtual int SendMany (const std::vector<Ptr<Packet> > &packets, uint32_t flags,
+                        const Address &address) = 0;
+  /**
+   * \brief Read a batch of messages
+   *
+   * \param packets the messages read are appended to it
+   * \param fromAddresses the address of the sender of each message is
+   * appended to it
+   * \param maxPackets the largest number of messages to read
+   * \param flags Socket control flags
+   * \returns the number of messages read, 0 if none was available
+   */
+  virtual uint32_t RecvMany (std::vector<Ptr<Packet> > &packets, std::vector<Address> &fromAddresses,
+                             uint32_t maxPackets, uint32_t flags) = 0;
+
 private:
   // Indirect the attribute setting and getting through private virtual methods
   /**
@@ -67,6 +97,63 @@ private:
    * \returns the buffer size
    */
   virtual uint32_t GetRcvBufSize (void) const = 0;
+  /**
+   * \brief Set the send buffer size
+   *
+   * The send buffer holds the messages not sent yet and the packets not
+   * acknowledged yet, Send fails with ERROR_AGAIN when it is full.
+   *
+   * \param size the buffer size
+   */
+  virtual void SetSndBufSize (uint32_t size) = 0;
+  /**
+   * \brief Get the send buffer size
+   * \returns the buffer size
+   */
+  virtual uint32_t GetSndBufSize (void) const = 0;
+  /**
+   * \brief Set the largest payload of a data packet
+   *
+   * Larger messages are split in fragments, reassembled by the receiver.
+   *
+   * \param size the size in bytes
+   */
+  virtual void SetSegmentSize (uint32_t size) = 0;
+  /**
+   * \brief Get the largest payload of a data packet
+   * \returns the size in bytes
+   */
+  virtual uint32_t GetSegmentSize (void) const = 0;
+  /**
+   * \brief Set the minimum number of data packets acknowledged by one ACK
+   * \param count the number of packets
+   */
+  virtual void SetAckFrequency (uint32_t count) = 0;
+  /**
+   * \brief Get the minimum number of data packets acknowledged by one ACK
+   * \returns the number of packets
+   */
+  virtual uint32_t GetAckFrequency (void) const = 0;
+  /**
+   * \brief Set the maximum number of data packets acknowledged by one ACK
+   * \param count the number of packets
+   */
+  virtual void SetMaxAckFrequency (uint32_t count) = 0;
+  /**
+   * \brief Get the maximum number of data packets acknowledged by one ACK
+   * \returns the number of packets
+   */
+  virtual uint32_t GetMaxAckFrequency (void) const = 0;
+  /**
+   * \brief Set the longest time a received data packet waits for its ACK
+   * \param timeout the delay
+   */
+  virtual void SetAckDelay (Time timeout) = 0;
+  /**
+   * \brief Get the longest time a received data packet waits for its ACK
+   * \returns the delay
+   */
+  virtual Time GetAckDelay (void) const = 0;
   /**
    * \brief Set the MTU discover capability
    *
@@ -79,6 +166,112 @@ private:
    * \returns the MTU discover capability
    */
   virtual bool GetMtuDiscover (void) const = 0;
+  /**
+   * \brief Enable or disable the RTT timestamp option
+   *
+   * The option is only used if both ends of the flow enable it.
+   *
+   * \param timestamps true to enable the timestamp option
+   */
+  virtual void SetTimestamps (bool timestamps) = 0;
+  /**
+   * \brief Get whether the RTT timestamp option is enabled
+   *
+   * \returns true if the timestamp option is enabled
+   */
+  virtual bool GetTimestamps (void) const = 0;
+  /**
+   * \brief Enable or disable bundling of small messages into one packet
+   *
+   * \param bundling true to enable message bundling
+   */
+  virtual void SetMessageBundling (bool bundling) = 0;
+  /**
+   * \brief Get whether small messages are bundled into one packet
+   *
+   * \returns true if message bundling is enabled
+   */
+  virtual bool GetMessageBundling (void) const = 0;
+  /**
+   * \brief Set the largest payload of a bundle of messages
+   * \param size the size in bytes
+   */
+  virtual void SetMaxBundleSize (uint32_t size) = 0;
+  /**
+   * \brief Get the largest payload of a bundle of messages
+   * \returns the size in bytes
+   */
+  virtual uint32_t GetMaxBundleSize (void) const = 0;
+  /**
+   * \brief Set the longest time a message waits for others to be bundled with
+   * \param delay the delay, 0 bundles the messages sent at the same time
+   */
+  virtual void SetBundleDelay (Time delay) = 0;
+  /**
+   * \brief Get the longest time a message waits for others to be bundled with
+   * \returns the delay
+   */
+  virtual Time GetBundleDelay (void) const = 0;
+  /**
+   * \brief Set whether the messages sent are delivered in order
+   * \param inOrder true to flag the messages sent as in-order
+   */
+  virtual void SetInOrderDelivery (bool inOrder) = 0;
+  /**
+   * \brief Get whether the messages sent are delivered in order
+   * \returns true if the messages sent are flagged as in-order
+   */
+  virtual bool GetInOrderDelivery (void) const = 0;
+  /**
+   * \brief Set the congestion controller
+   * \param congestionControl the TypeId of a subclass of RudpCongestionOps
+   */
+  virtual void SetCongestionControl (TypeId congestionControl) = 0;
+  /**
+   * \brief Get the congestion controller
+   * \returns the TypeId of the congestion controller
+   */
+  virtual TypeId GetCongestionControl (void) const = 0;
+};
+
+/**
+ * \ingroup socket
+ *
+ * \brief Time-to-live of a message
+ *
+ * Added to a message passed to Send or SendTo, it makes the message
+ * partially reliable: once the time-to-live has elapsed, the message is
+ * no longer sent nor retransmitted and the receiver skips it.
+ */
+class RudpMessageTtlTag : public Tag
+{
+public:
+  RudpMessageTtlTag ();
+
+  /**
+   * \brief Set the time-to-live of the message
+   * \param ttl the time-to-live, counted from the call to Send
+   */
+  void SetTtl (Time ttl);
+  /**
+   * \brief Get the time-to-live of the message
+   * \returns the time-to-live
+   */
+  Time GetTtl (void) const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  Time m_ttl; //!< Time-to-live of the message
 };
 
 } // namespace ns3